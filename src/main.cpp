@@ -57,7 +57,7 @@ static void mainThread(void* dll)
     std::cout << Minecraft.get_name() << '\n';
     std::cout << Minecraft.get_signature() << '\n';
     maps::Minecraft theMinecraft = Minecraft.theMinecraft.get();
-    maps::Minecraft g_theMinecraft = maps::Minecraft(theMinecraft, true);
+    maps::Minecraft::global g_theMinecraft{ theMinecraft };
     std::cout << "display width test: " << theMinecraft.displayWidth.get() << '\n';
     theMinecraft.displayWidth = 100;
     std::cout << "display width test after change: " << theMinecraft.displayWidth.get() << '\n';
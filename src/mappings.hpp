@@ -9,9 +9,10 @@ namespace maps
 	END_KLASS_DEF()
 
 	BEGIN_KLASS_DEF(String, "java/lang/String")
-		static String create(const char* str)
+		static String create(std::string_view str) // UTF-8
 		{
-			return String(jni::get_env()->NewStringUTF(str));
+			std::string buffer{};
+			return String(jni::_track_local_ref(jni::get_env()->NewStringUTF(jni::_to_modified_utf8(str, buffer))));
 		}
 
 
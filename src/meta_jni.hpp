@@ -7,6 +7,7 @@
 #endif
 #include <jni.h>
 #include <string_view>
+#include <string>
 #include <type_traits>
 #include <memory>
 #include <vector>
@@ -14,6 +15,43 @@
 #include <shared_mutex>
 #include <cstdint>
 #include <functional>
+#include <algorithm>
+#include <iterator>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+#include <source_location>
+#include <chrono>
+#include <bit>
+#include <concepts>
+#include <optional>
+
+#if defined(METAJNI_LOCAL_REF_STATS) || defined(METAJNI_CALL_STATS) || defined(METAJNI_GC_STATS)
+	#include <ostream>
+#endif
+#ifdef METAJNI_CALL_STATS
+	#include <iostream>
+#endif
+#ifdef METAJNI_CALL_TRACE
+	#include <cstdio>
+	#include <thread>
+	#ifdef _WIN32
+		#include <intrin.h>
+	#elif defined(__linux__)
+		#include <unistd.h>
+		#include <sys/syscall.h>
+		#if defined(__x86_64__) || defined(__i386__)
+			#include <x86intrin.h>
+		#endif
+	#endif
+#endif
+
+#if defined(METAJNI_USDT) && defined(__linux__) // static probes for perf / bpftrace / SystemTap, nops unless a tracer is attached (apt install systemtap-sdt-dev)
+	#include <sys/sdt.h>
+	#define METAJNI_PROBE(probe_name, klass_name, member_name, signature, env) DTRACE_PROBE4(metajni, probe_name, klass_name, member_name, signature, env)
+#else
+	#define METAJNI_PROBE(probe_name, klass_name, member_name, signature, env)
+#endif
 
 #ifdef NDEBUG
 	#define assertm(exp, msg) ;
@@ -22,23 +60,37 @@
 	#define assertm(exp, msg) if (!exp) { std::cout << msg << '\n'; abort(); }
 #endif
 
-#define BEGIN_KLASS_DEF(unobf_klass_name, obf_klass_name) struct unobf_klass_name##_members; using unobf_klass_name = jni::klass<obf_klass_name, unobf_klass_name##_members>; struct unobf_klass_name##_members : public jni::empty_members	{ unobf_klass_name##_members(jclass owner_klass, jobject object_instance, bool is_global_ref) : jni::empty_members(owner_klass, object_instance, is_global_ref) {}
-
-#define END_KLASS_DEF()	};
-
-#define BEGIN_KLASS_DEF_EX(unobf_klass_name, obf_klass_name, inherit_from) struct unobf_klass_name##_members; using unobf_klass_name = jni::klass<obf_klass_name, unobf_klass_name##_members>; struct unobf_klass_name##_members : public inherit_from##_members { unobf_klass_name##_members(jclass owner_klass, jobject object_instance, bool is_global_ref) : inherit_from##_members(owner_klass, object_instance, is_global_ref) {}
-
-#define KLASS_DECLARATION(unobf_klass_name, obf_klass_name) struct unobf_klass_name##_members; using unobf_klass_name = jni::klass<obf_klass_name, unobf_klass_name##_members>;
-#define BEGIN_KLASS_MEMBERS_EX(unobf_klass_name, inherit_from) struct unobf_klass_name##_members : public inherit_from##_members { unobf_klass_name##_members(jclass owner_klass, jobject object_instance, bool is_global_ref) : inherit_from##_members(owner_klass, object_instance, is_global_ref) {}
-#define BEGIN_KLASS_MEMBERS(unobf_klass_name) BEGIN_KLASS_MEMBERS_EX(unobf_klass_name, jni::empty)
-#define END_KLASS_MEMBERS()	};
+#include "meta_jni_macros.hpp"
 
 namespace jni
 {
 	inline uint32_t _tls_index = 0;
+	inline uint32_t _frame_tls_index = 0; // innermost jni::frame of the thread
 	inline std::vector<jobject> _refs_to_delete{};
 	inline std::mutex _refs_to_delete_mutex{};
 	inline std::function<jclass(const char* class_name)> _custom_find_class{};
+	inline std::atomic<jclass(*)(JNIEnv* env, const char* class_name)> _indexed_find_class{ nullptr }; // set by jni::jvmti::class_index, returns a local ref
+
+	struct _deferred_ref
+	{
+		jobject object;
+		bool is_weak;
+		_deferred_ref* next;
+	};
+	inline std::atomic<_deferred_ref*> _deferred_refs{ nullptr }; // lock-free stack, any thread pushes, drain_deferred_refs takes everything at once
+	inline std::atomic<int32_t> _deferred_refs_pending{ 0 }; // counted before the push, so a drain never takes a node that isn't counted yet
+	inline std::atomic<bool> _is_shutdown{ false };
+	inline constexpr uint32_t deferred_refs_batch_size = 64;
+
+	struct deferred_ref_stats
+	{
+		uint64_t queued;
+		uint64_t drained;
+		uint64_t leaked; // released after jni::shutdown, nothing can delete them anymore
+	};
+	inline std::atomic<uint64_t> _deferred_refs_queued{ 0 };
+	inline std::atomic<uint64_t> _deferred_refs_drained{ 0 };
+	inline std::atomic<uint64_t> _deferred_refs_leaked{ 0 };
 
 	inline JNIEnv* get_env()
 	{
@@ -49,6 +101,59 @@ namespace jni
 		return (JNIEnv*)pthread_getspecific(_tls_index);
 #endif
 	}
+
+	inline void drain_deferred_refs() // deletes the global refs queued by delete_global_ref, needs a thread with a JNIEnv
+	{
+		JNIEnv* env = get_env();
+		if (!env || !_deferred_refs.load(std::memory_order_relaxed)) return;
+		_deferred_ref* node = _deferred_refs.exchange(nullptr, std::memory_order_acquire);
+		int32_t count = 0; // length of the list taken, every node of it was already counted in _deferred_refs_pending
+		while (node)
+		{
+			_deferred_ref* next = node->next;
+			if (node->is_weak)
+				env->DeleteWeakGlobalRef(node->object);
+			else
+				env->DeleteGlobalRef(node->object);
+			delete node;
+			node = next;
+			++count;
+		}
+		_deferred_refs_pending.fetch_sub(count, std::memory_order_relaxed);
+		_deferred_refs_drained.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	inline void _defer_ref_deletion(jobject object, bool is_weak)
+	{
+		if (!object) return;
+		if (_is_shutdown.load(std::memory_order_relaxed))
+		{
+			_deferred_refs_leaked.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		int32_t pending = _deferred_refs_pending.fetch_add(1, std::memory_order_relaxed) + 1;
+		_deferred_ref* node = new _deferred_ref{ object, is_weak, _deferred_refs.load(std::memory_order_relaxed) };
+		while (!_deferred_refs.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed));
+		_deferred_refs_queued.fetch_add(1, std::memory_order_relaxed);
+		if (pending >= (int32_t)deferred_refs_batch_size)
+			drain_deferred_refs();
+	}
+
+	inline void delete_global_ref(jobject object) // safe from any thread, even without a JNIEnv
+	{
+		_defer_ref_deletion(object, false);
+	}
+
+	inline void delete_weak_global_ref(jweak object)
+	{
+		_defer_ref_deletion(object, true);
+	}
+
+	inline deferred_ref_stats get_deferred_ref_stats()
+	{
+		return { _deferred_refs_queued.load(std::memory_order_relaxed), _deferred_refs_drained.load(std::memory_order_relaxed), _deferred_refs_leaked.load(std::memory_order_relaxed) };
+	}
+
 	inline void set_thread_env(JNIEnv* new_env)
 	{
 		if (get_env()) return;
@@ -57,6 +162,7 @@ namespace jni
 #elif __linux__
 		pthread_setspecific(_tls_index, new_env);
 #endif
+		drain_deferred_refs();
 	}
 
 	inline void init()
@@ -68,6 +174,11 @@ namespace jni
 		pthread_key_create(&_tls_index, nullptr);
 #endif
 		assertm(_tls_index, "tls index allocation failed");
+#ifdef _WIN32
+		_frame_tls_index = TlsAlloc();
+#elif __linux__
+		pthread_key_create(&_frame_tls_index, nullptr);
+#endif
 	}
 	inline void shutdown() //needs to be called on exit, library unusable after this
 	{
@@ -81,11 +192,15 @@ namespace jni
 			}
 			_custom_find_class = {}; // destroy in case the custom find class stores a classloader reference
 		}
+		drain_deferred_refs();
+		_is_shutdown = true; // refs released from now on are counted as leaked
 		
 #ifdef _WIN32
 		TlsFree(_tls_index);
+		TlsFree(_frame_tls_index);
 #elif __linux__
 		pthread_key_delete(_tls_index);
+		pthread_key_delete(_frame_tls_index);
 #endif
 	}
 
@@ -126,470 +241,1996 @@ namespace jni
 		return string_litteral(concatenated);
 	}
 
-	template<typename klass_type> struct jclass_cache
+	inline void* _tls_get(uint32_t index)
 	{
-		inline static std::shared_mutex mutex{};
-		inline static jclass value = nullptr;
-	};
+#ifdef _WIN32
+		return TlsGetValue(index);
+#elif __linux__
+		return pthread_getspecific(index);
+#endif
+	}
 
-	template<typename klass_type> inline jclass get_cached_jclass() //findClass
+	inline void _tls_set(uint32_t index, void* value)
 	{
-		JNIEnv* env = get_env();
-		if (!env) return nullptr;
-		jclass& cached = jclass_cache<klass_type>::value;
+#ifdef _WIN32
+		TlsSetValue(index, value);
+#elif __linux__
+		pthread_setspecific(index, value);
+#endif
+	}
+
+	template<class T, bool recycled = false>
+	class per_thread // one T per thread created on first use, instances are never freed so they stay readable for reports
+	{ // recycled: the T of an exited thread goes to the next thread calling get(), if T has a bool recycle() it must accept it first
+	public:
+		T& get()
 		{
-			std::shared_lock shared_lock{ jclass_cache<klass_type>::mutex };
-			if (cached) return cached;
+			std::call_once(index_allocated, [this]
+			{
+#ifdef _WIN32
+				index = recycled ? FlsAlloc(&thread_exited) : TlsAlloc(); // FLS callbacks run on thread exit, TLS has none
+#elif __linux__
+				pthread_key_create(&index, recycled ? &thread_exited : nullptr);
+#endif
+			});
+			node* value = (node*)get_value();
+			if (value) return value->instance;
+			value = recycled ? take_recycled() : nullptr;
+			if (!value)
+			{
+				value = new node{ {}, this };
+				std::lock_guard lock{ mutex };
+				instances.push_back(&value->instance);
+			}
+			set_value(value);
+			return value->instance;
 		}
-		jclass local = env->FindClass(klass_type::get_name());
-		if (env->ExceptionCheck())
-			env->ExceptionClear();
-		jclass found = (jclass)env->NewGlobalRef(local);
-		if (!found && _custom_find_class)
-			found = (jclass)env->NewGlobalRef(_custom_find_class(klass_type::get_name()));
-		assertm(found, (const char*)(concat<"failed to find class: ", klass_type::get_name()>()));
+
+		template<class function_type>
+		void for_each(function_type&& function)
 		{
-			std::unique_lock unique_lock{ jclass_cache<klass_type>::mutex };
-			cached = found;
+			std::lock_guard lock{ mutex };
+			for (T* instance : instances)
+				function(*instance);
 		}
+	private:
+		struct node
 		{
-			std::lock_guard lock{ _refs_to_delete_mutex };
-			_refs_to_delete.push_back(found);
+			T instance;
+			per_thread* owner;
+		};
+
+		void* get_value() const
+		{
+#ifdef _WIN32
+			if constexpr (recycled) return FlsGetValue(index);
+#endif
+			return _tls_get(index);
+		}
+
+		void set_value(void* value)
+		{
+#ifdef _WIN32
+			if constexpr (recycled) { FlsSetValue(index, value); return; }
+#endif
+			_tls_set(index, value);
+		}
+
+		node* take_recycled()
+		{
+			std::lock_guard lock{ mutex };
+			for (auto it = free_nodes.begin(); it != free_nodes.end(); ++it)
+			{
+				node* value = *it;
+				if constexpr (requires { { value->instance.recycle() } -> std::same_as<bool>; })
+					if (!value->instance.recycle()) continue;
+				free_nodes.erase(it);
+				return value;
+			}
+			return nullptr;
+		}
+
+#ifdef _WIN32
+		static void NTAPI thread_exited(void* value)
+#else
+		static void thread_exited(void* value)
+#endif
+		{
+			if (!value) return;
+			node* exited = (node*)value;
+			std::lock_guard lock{ exited->owner->mutex };
+			exited->owner->free_nodes.push_back(exited);
 		}
-		return found;
-	}
 
+		std::once_flag index_allocated{};
+		uint32_t index = 0;
+		std::mutex mutex{};
+		std::vector<T*> instances{};
+		std::vector<node*> free_nodes{}; // of exited threads, only when recycled
+	};
 
-	class object_wrapper
+	struct member_site // a jni::field / jni::method of one klass (or other library operation), identified by klass name, name and signature
 	{
-	public:
-		object_wrapper(jobject object_instance, bool is_global_ref) :
-			object_instance((is_global_ref && object_instance ? get_env()->NewGlobalRef(object_instance) : object_instance)),
-			is_global_ref(is_global_ref)
+		member_site(const char* klass_name, const char* name, const char* signature, bool is_static) :
+			klass_name(klass_name),
+			name(name),
+			signature(signature),
+			is_static(is_static)
 		{
 		}
 
-		object_wrapper(const object_wrapper& other) :
-			object_wrapper(other.object_instance, other.is_global_ref)
+		const char* klass_name; // as written in the mappings, empty for operations on no klass
+		const char* name;
+		const char* signature;
+		bool is_static;
+		uint32_t index = 0; // dense, position in _member_sites()
+#ifdef METAJNI_LOCAL_REF_STATS
+		std::atomic<uint64_t> local_refs_created{ 0 };
+		std::atomic<uint64_t> local_refs_unframed{ 0 }; // created while no jni::frame was pushed on the thread
+#endif
+	};
+
+	inline std::vector<member_site*>& _member_sites() // function static, member sites are created during static initialization of other headers
+	{
+		static std::vector<member_site*> sites{};
+		return sites;
+	}
+	inline std::mutex _member_sites_mutex{};
+
+	inline member_site& _get_member_site(const char* klass_name, const char* name, const char* signature, bool is_static) // strings must be static, created on first use and never freed
+	{
+		static std::unordered_map<std::string, member_site*> sites_by_key{}; // a member declared in a base klass has a site per derived klass, like its IDs
+		std::string key = std::string(klass_name) + '.' + name + ' ' + signature + (is_static ? " static" : "");
+		std::lock_guard lock{ _member_sites_mutex };
+		auto [it, inserted] = sites_by_key.try_emplace(std::move(key), nullptr);
+		if (inserted)
 		{
+			it->second = new member_site(klass_name, name, signature, is_static);
+			it->second->index = (uint32_t)_member_sites().size();
+			_member_sites().push_back(it->second);
 		}
+		return *it->second;
+	}
+
+	template<string_litteral klass_name, string_litteral name, string_litteral signature, bool is_static = false>
+	inline member_site& get_member_site() // of an operation known at compile time
+	{
+		static member_site& site = _get_member_site(klass_name, name, signature, is_static);
+		return site;
+	}
+
+#ifdef METAJNI_LOCAL_REF_STATS
+	namespace local_refs
+	{
+		struct thread_stats // written by its thread only, atomics so reports can read them from any thread
+		{
+			std::atomic<uint64_t> created{ 0 };
+			std::atomic<uint64_t> deleted{ 0 }; // by jni::delete_local_ref or by popping their frame
+			std::atomic<uint64_t> unframed{ 0 };
+			std::atomic<uint64_t> overflows{ 0 }; // frames that needed more refs than their capacity
+			std::atomic<jint> high_water{ 0 }; // biggest number of live refs seen in a single frame
+		};
+		inline per_thread<thread_stats> _threads{};
+
+		struct frame_location_stats
+		{
+			const char* file;
+			uint32_t line;
+			jint capacity; // capacity the frame was pushed with
+			jint high_water;
+			uint64_t frames;
+			uint64_t overflows;
+		};
+		inline std::mutex _frame_locations_mutex{};
+		inline std::vector<frame_location_stats> _frame_locations{};
 
-		virtual ~object_wrapper()
+		inline void _add(std::atomic<uint64_t>& counter, uint64_t value)
 		{
-			if (is_global_ref)
-				clear_ref();
+			counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed); // single writer
 		}
 
-		object_wrapper& operator=(const object_wrapper& other) //operator = keeps the current ref type
+		inline void _frame_popped(const std::source_location& location, jint capacity, jint peak, jint remaining, bool overflowed)
 		{
-			if (is_global_ref)
+			thread_stats& thread = _threads.get();
+			_add(thread.deleted, remaining);
+			if (overflowed) _add(thread.overflows, 1);
+			if (peak > thread.high_water.load(std::memory_order_relaxed))
+				thread.high_water.store(peak, std::memory_order_relaxed);
+
+			std::lock_guard lock{ _frame_locations_mutex };
+			auto it = std::find_if(_frame_locations.begin(), _frame_locations.end(), [&](const frame_location_stats& stats)
 			{
-				jobject old_instance = object_instance; // set before deleting, eg if operator= is called on itself or on an object_wrapper with the same object_instance
-				object_instance = (other.object_instance ? get_env()->NewGlobalRef(other.object_instance) : nullptr);
-				if (old_instance) get_env()->DeleteGlobalRef(old_instance);
-			}
-			else
-				object_instance = other.object_instance;
-			return *this;
+				return stats.line == location.line() && std::string_view(stats.file) == location.file_name();
+			});
+			if (it == _frame_locations.end())
+				it = _frame_locations.insert(_frame_locations.end(), { location.file_name(), location.line(), capacity, 0, 0, 0 });
+			it->capacity = capacity; // scoped frames change capacity as they learn
+			it->high_water = (std::max)(it->high_water, peak);
+			it->frames += 1;
+			it->overflows += overflowed;
 		}
+	}
+#endif
 
-		bool operator==(const object_wrapper& other) const
+	struct frame_site // local ref usage of every jni::scoped_frame created at the same place
+	{
+		std::atomic<jint> capacity{ 4 }; // learned from high_water, used for the next PushLocalFrame
+		std::atomic<jint> high_water{ 0 };
+	};
+
+	class frame
+	{
+	public:
+		frame(jint capacity = 16, [[maybe_unused]] std::source_location location = std::source_location::current()) :
+			capacity(capacity),
+			parent(get_current())
+#ifdef METAJNI_LOCAL_REF_STATS
+			, initial_capacity(capacity),
+			location(location)
+#endif
 		{
-			return is_same_object(other);
+			if (_deferred_refs_pending.load(std::memory_order_relaxed) > 0)
+				drain_deferred_refs();
+			get_env()->PushLocalFrame(capacity);
+			set_current(this);
 		}
 
-		bool is_same_object(const object_wrapper& other) const
+		frame(const frame& other) = delete;
+
+		~frame()
 		{
-			return get_env()->IsSameObject(object_instance, other.object_instance) == JNI_TRUE;
+			if (!popped)
+				pop(nullptr);
 		}
 
-		template<typename klass_type>
-		bool is_instance_of() const
+		template<class T>
+		T pop_with(const T& result) // pops the frame and returns result as a local ref of the parent frame
 		{
-			return get_env()->IsInstanceOf(object_instance, get_cached_jclass<klass_type>()) == JNI_TRUE;
+			return T(pop((jobject)result));
 		}
 
-		void clear_ref()
+		void local_ref_created()
 		{
-			if (!object_instance) return;
-			if (is_global_ref && get_env())
-				get_env()->DeleteGlobalRef(object_instance);
-			object_instance = nullptr;
+			if (++used > peak) peak = used;
+			if (used <= capacity) return;
+#ifdef METAJNI_LOCAL_REF_STATS
+			overflowed = true;
+#endif
+			get_env()->EnsureLocalCapacity(capacity); // room for as many refs again
+			capacity *= 2;
 		}
 
-		operator jobject() const
+		void local_ref_deleted()
 		{
-			return this->object_instance;
+			if (used) --used;
 		}
 
-		operator bool() const
+		jint get_used() const // live refs created through the library in this frame
 		{
-			return this->object_instance;
+			return used;
 		}
 
-		bool is_global() const
+		jint get_peak() const
 		{
-			return is_global_ref;
+			return peak;
 		}
 
-		jobject object_instance;
+		static frame* get_current()
+		{
+			if (!_frame_tls_index) return nullptr;
+			return (frame*)_tls_get(_frame_tls_index);
+		}
+	protected:
+		frame(frame_site& site, std::source_location location) :
+			frame(site.capacity.load(std::memory_order_relaxed), location)
+		{
+			this->site = &site;
+		}
 	private:
-		bool is_global_ref; //global refs aren't destroyed on PopLocalFrame, and can be shared between threads
+		static void set_current(frame* current)
+		{
+			_tls_set(_frame_tls_index, current);
+		}
+
+		jobject pop(jobject result)
+		{
+			popped = true;
+			if (site)
+			{
+				jint high_water = site->high_water.load(std::memory_order_relaxed);
+				while (peak > high_water && !site->high_water.compare_exchange_weak(high_water, peak, std::memory_order_relaxed));
+				if (peak > high_water)
+					site->capacity.store(peak, std::memory_order_relaxed);
+			}
+#ifdef METAJNI_LOCAL_REF_STATS
+			local_refs::_frame_popped(location, initial_capacity, peak, used, overflowed);
+#endif
+			set_current(parent);
+			jobject parent_ref = get_env()->PopLocalFrame(result);
+			if (parent_ref && parent)
+				parent->local_ref_created();
+			return parent_ref;
+		}
+
+		jint capacity;
+		jint used = 0;
+		jint peak = 0;
+		bool popped = false;
+		frame* parent;
+		frame_site* site = nullptr;
+#ifdef METAJNI_LOCAL_REF_STATS
+		jint initial_capacity;
+		bool overflowed = false;
+		std::source_location location;
+#endif
 	};
 
-	struct empty_members : public object_wrapper
+	class scoped_frame : public frame // capacity is learned from the previous frames of the same site, see JNI_SCOPED_FRAME
 	{
-		empty_members(jclass owner_klass, jobject object_instance, bool is_global_ref) :
-			object_wrapper(object_instance, is_global_ref),
-			owner_klass(owner_klass)
+	public:
+		scoped_frame(frame_site& site, std::source_location location = std::source_location::current()) :
+			frame(site, location)
 		{
 		}
-
-		jclass owner_klass;
 	};
 
-	template<typename T, typename... U> inline constexpr bool is_any_of_type = (std::is_same_v<T, U> || ...);
-	template<typename T> inline constexpr bool is_jni_primitive_type = is_any_of_type<T, jboolean, jbyte, jchar, jshort, jint, jfloat, jlong, jdouble>;
+	template<class T> inline T _track_local_ref(T ref, [[maybe_unused]] member_site* site) // counts local refs created by the library in the current frame, site is the jni::field / jni::method creating it
+	{
+		if (!ref) return ref;
+		frame* current = frame::get_current();
+		if (current)
+			current->local_ref_created();
+#ifdef METAJNI_LOCAL_REF_STATS
+		local_refs::thread_stats& thread = local_refs::_threads.get();
+		local_refs::_add(thread.created, 1);
+		if (!current) local_refs::_add(thread.unframed, 1);
+		if (site)
+		{
+			site->local_refs_created.fetch_add(1, std::memory_order_relaxed);
+			if (!current) site->local_refs_unframed.fetch_add(1, std::memory_order_relaxed);
+		}
+#endif
+		return ref;
+	}
 
-	enum is_static_t : bool
+	template<class site_type = void, class T> inline T _track_local_ref(T ref) // site_type has a static get_site() for operations known at compile time
 	{
-		STATIC = true,
-		NOT_STATIC = false
-	};
+#ifdef METAJNI_LOCAL_REF_STATS
+		if constexpr (!std::is_void_v<site_type>)
+			return _track_local_ref(ref, &site_type::get_site());
+#endif
+		return _track_local_ref(ref, nullptr);
+	}
 
-	template<class T> inline constexpr auto get_signature_for_type()
+	inline void delete_local_ref(jobject object) // DeleteLocalRef that keeps the frame counters right
 	{
-		if constexpr (std::is_void_v<T>) 
-			return string_litteral("V");
-		if constexpr (!is_jni_primitive_type<T> && !std::is_void_v<T>)
-			return T::get_signature();
-		if constexpr (std::is_same_v<jboolean, T>)
-			return string_litteral("Z");
-		if constexpr (std::is_same_v<jbyte, T>)
-			return string_litteral("B");
-		if constexpr (std::is_same_v<jchar, T>)
-			return string_litteral("C");
-		if constexpr (std::is_same_v<jshort, T>)
-			return string_litteral("S");
-		if constexpr (std::is_same_v<jint, T>)
-			return string_litteral("I");
-		if constexpr (std::is_same_v<jfloat, T>)
-			return string_litteral("F");
-		if constexpr (std::is_same_v<jlong, T>)
-			return string_litteral("J");
-		if constexpr (std::is_same_v<jdouble, T>)
-			return string_litteral("D");
+		if (!object) return;
+		get_env()->DeleteLocalRef(object);
+		if (frame* current = frame::get_current())
+			current->local_ref_deleted();
+#ifdef METAJNI_LOCAL_REF_STATS
+		local_refs::_add(local_refs::_threads.get().deleted, 1);
+#endif
 	}
 
-	template<class array_element_type>
-	class array : public object_wrapper
+#ifdef METAJNI_LOCAL_REF_STATS
+	namespace local_refs
 	{
-	public:
-		array(jobject object_instance, bool is_global_ref = false) :
-			object_wrapper(object_instance, is_global_ref)
+		struct totals
+		{
+			uint64_t created;
+			uint64_t deleted;
+			uint64_t unframed;
+			uint64_t overflows;
+			jint high_water;
+			uint32_t threads;
+		};
+
+		inline totals get_totals() // every thread merged
 		{
+			totals result{};
+			_threads.for_each([&](thread_stats& thread)
+			{
+				result.created += thread.created.load(std::memory_order_relaxed);
+				result.deleted += thread.deleted.load(std::memory_order_relaxed);
+				result.unframed += thread.unframed.load(std::memory_order_relaxed);
+				result.overflows += thread.overflows.load(std::memory_order_relaxed);
+				result.high_water = (std::max)(result.high_water, thread.high_water.load(std::memory_order_relaxed));
+				result.threads += 1;
+			});
+			return result;
 		}
 
-		array& operator=(const array& other) //operator= is not inherited by default
+		inline std::vector<frame_location_stats> get_frame_locations()
 		{
-			object_wrapper::operator=(other);
-			return *this;
+			std::lock_guard lock{ _frame_locations_mutex };
+			return _frame_locations;
 		}
 
-		std::vector<array_element_type> to_vector() const
+		inline jint suggested_capacity(const char* file, uint32_t line) // observed high water of the frames pushed at file:line, 0 if never seen
 		{
-			jsize length = get_length();
-			std::vector<array_element_type> vector{};
-			vector.reserve(length);
-			if constexpr (!is_jni_primitive_type<array_element_type>)
-			{
-				for (jsize i = 0; i < length; ++i)
-					vector.push_back( array_element_type(get_env()->GetObjectArrayElement((jobjectArray)object_instance, i)) );
-			}
-			if constexpr (std::is_same_v<jboolean, array_element_type>)
-			{
-				std::unique_ptr<jboolean[]> buffer = std::make_unique<jboolean[]>(length);
-				get_env()->GetBooleanArrayRegion((jbooleanArray)object_instance, 0, length, buffer.get());
-				vector.insert(vector.begin(), buffer.get(), buffer.get() + length);
-			}
-			if constexpr (std::is_same_v<jbyte, array_element_type>)
-			{
-				std::unique_ptr<jbyte[]> buffer = std::make_unique<jbyte[]>(length);
-				get_env()->GetByteArrayRegion((jbyteArray)object_instance, 0, length, buffer.get());
-				vector.insert(vector.begin(), buffer.get(), buffer.get() + length);
-			}
-			if constexpr (std::is_same_v<jchar, array_element_type>)
-			{
-				std::unique_ptr<jchar[]> buffer = std::make_unique<jchar[]>(length);
-				get_env()->GetCharArrayRegion((jcharArray)object_instance, 0, length, buffer.get());
-				vector.insert(vector.begin(), buffer.get(), buffer.get() + length);
-			}
-			if constexpr (std::is_same_v<jshort, array_element_type>)
-			{
-				std::unique_ptr<jshort[]> buffer = std::make_unique<jshort[]>(length);
-				get_env()->GetShortArrayRegion((jshortArray)object_instance, 0, length, buffer.get());
-				vector.insert(vector.begin(), buffer.get(), buffer.get() + length);
-			}
-			if constexpr (std::is_same_v<jint, array_element_type>)
-			{
-				std::unique_ptr<jint[]> buffer = std::make_unique<jint[]>(length);
-				get_env()->GetIntArrayRegion((jintArray)object_instance, 0, length, buffer.get());
-				vector.insert(vector.begin(), buffer.get(), buffer.get() + length);
-			}
-			if constexpr (std::is_same_v<jfloat, array_element_type>)
-			{
-				std::unique_ptr<jfloat[]> buffer = std::make_unique<jfloat[]>(length);
-				get_env()->GetFloatArrayRegion((jfloatArray)object_instance, 0, length, buffer.get());
-				vector.insert(vector.begin(), buffer.get(), buffer.get() + length);
-			}
-			if constexpr (std::is_same_v<jlong, array_element_type>)
+			std::lock_guard lock{ _frame_locations_mutex };
+			for (const frame_location_stats& stats : _frame_locations)
+				if (stats.line == line && std::string_view(stats.file) == file)
+					return stats.high_water;
+			return 0;
+		}
+
+		inline void report(std::ostream& out)
+		{
+			totals t = get_totals();
+			out << "local refs: created " << t.created << ", deleted " << t.deleted << ", live " << (int64_t)(t.created - t.deleted)
+				<< ", unframed " << t.unframed << ", overflows " << t.overflows << ", high water " << t.high_water << ", threads " << t.threads << '\n';
+			for (const frame_location_stats& stats : get_frame_locations())
 			{
-				std::unique_ptr<jlong[]> buffer = std::make_unique<jlong[]>(length);
-				get_env()->GetLongArrayRegion((jlongArray)object_instance, 0, length, buffer.get());
-				vector.insert(vector.begin(), buffer.get(), buffer.get() + length);
+				out << "  frame " << stats.file << ':' << stats.line << " capacity " << stats.capacity << " high water " << stats.high_water
+					<< " frames " << stats.frames << " overflows " << stats.overflows;
+				if (stats.high_water > stats.capacity) out << "  <- exceeds capacity";
+				out << '\n';
 			}
-			if constexpr (std::is_same_v<jdouble, array_element_type>)
+			std::lock_guard lock{ _member_sites_mutex };
+			for (member_site* site : _member_sites())
 			{
-				std::unique_ptr<jdouble[]> buffer = std::make_unique<jdouble[]>(length);
-				get_env()->GetDoubleArrayRegion((jdoubleArray)object_instance, 0, length, buffer.get());
-				vector.insert(vector.begin(), buffer.get(), buffer.get() + length);
+				uint64_t created = site->local_refs_created.load(std::memory_order_relaxed);
+				if (!created) continue;
+				out << "  " << (*site->klass_name ? site->klass_name : "?") << '.' << site->name << ' ' << site->signature << " created " << created
+					<< " unframed " << site->local_refs_unframed.load(std::memory_order_relaxed) << '\n';
 			}
-			return vector;
 		}
+	}
+#endif
 
-		jsize get_length() const
+	inline std::string get_class_name(jclass klass_object) // java name of a class, eg "net.minecraft.client.Minecraft"
+	{
+		JNIEnv* env = get_env();
+		if (!env || !klass_object) return std::string();
+		frame name_frame{ 4 };
+		jclass class_klass = env->GetObjectClass(klass_object);
+		jmethodID get_name = env->GetMethodID(class_klass, "getName", "()Ljava/lang/String;");
+		jstring name = (jstring)env->CallObjectMethod(klass_object, get_name);
+		if (env->ExceptionCheck())
 		{
-			return get_env()->GetArrayLength((jarray)object_instance);
+			env->ExceptionClear();
+			return std::string();
 		}
+		const char* chars = env->GetStringUTFChars(name, nullptr);
+		std::string result = chars ? chars : "";
+		env->ReleaseStringUTFChars(name, chars);
+		return result;
+	}
 
-		static constexpr auto get_signature()
+	inline uint64_t _timestamp_ns()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+#ifdef METAJNI_CALL_STATS
+	namespace stats
+	{
+		// log-linear buckets like HdrHistogram: values below 16ns are exact, above that every power of 2 is split in 8 (12.5% precision), up to ~68s
+		inline constexpr uint32_t histogram_sub_buckets = 8;
+		inline constexpr uint32_t histogram_buckets = 16 + (36 - 4) * histogram_sub_buckets;
+
+		inline uint32_t _bucket_of(uint64_t ns)
 		{
-			return concat<"[", get_signature_for_type<array_element_type>()>();
+			if (ns < 16) return (uint32_t)ns;
+			uint32_t exponent = 63 - (uint32_t)std::countl_zero(ns);
+			if (exponent >= 36) return histogram_buckets - 1;
+			uint32_t sub_bucket = (uint32_t)(ns >> (exponent - 3)) & (histogram_sub_buckets - 1);
+			return 16 + (exponent - 4) * histogram_sub_buckets + sub_bucket;
 		}
 
-		static constexpr auto get_name() //this is used for FindClass
+		inline uint64_t _bucket_upper_bound(uint32_t bucket)
 		{
-			return get_signature();
+			if (bucket < 16) return bucket;
+			uint32_t exponent = (bucket - 16) / histogram_sub_buckets + 4;
+			uint64_t sub_bucket = (bucket - 16) % histogram_sub_buckets;
+			return ((histogram_sub_buckets + sub_bucket + 1) << (exponent - 3)) - 1;
 		}
 
-		static array create(const std::vector<array_element_type>& values)
+		struct member_stats // one thread's data for one member, single writer
 		{
-			jobject object = nullptr;
-			if constexpr (!is_jni_primitive_type<array_element_type>)
-			{
-				object = get_env()->NewObjectArray((jsize)values.size(), get_cached_jclass<array_element_type>(), nullptr);
-				for (jsize i = 0; i < values.size(); ++i)
-					get_env()->SetObjectArrayElement((jobjectArray)object, i, (jobject)values[i]);
-			}
-			if constexpr (std::is_same_v<jboolean, array_element_type>)
-			{
-				object = get_env()->NewBooleanArray((jsize)values.size());
-				get_env()->SetBooleanArrayRegion((jbooleanArray)object, 0, (jsize)values.size(), values.data());
-			}
-			if constexpr (std::is_same_v<jbyte, array_element_type>)
+			std::atomic<uint64_t> count{ 0 };
+			std::atomic<uint64_t> total_ns{ 0 };
+			std::atomic<uint64_t> max_ns{ 0 };
+			std::atomic<uint64_t> buckets[histogram_buckets]{};
+		};
+
+		struct thread_shard // member_stats indexed by member_site::index, in pages so they can be allocated lazily without moving
+		{
+			static constexpr uint32_t page_size = 256;
+			static constexpr uint32_t page_count = 256;
+
+			member_stats* find(uint32_t index) const
 			{
-				object = get_env()->NewByteArray((jsize)values.size());
-				get_env()->SetByteArrayRegion((jbyteArray)object, 0, (jsize)values.size(), values.data());
+				std::atomic<member_stats*>* page = pages[index / page_size].load(std::memory_order_acquire);
+				return page ? page[index % page_size].load(std::memory_order_acquire) : nullptr;
 			}
-			if constexpr (std::is_same_v<jchar, array_element_type>)
+
+			member_stats& get(uint32_t index)
 			{
-				object = get_env()->NewCharArray((jsize)values.size());
-				get_env()->SetCharArrayRegion((jcharArray)object, 0, (jsize)values.size(), values.data());
+				if (member_stats* found = find(index)) return *found;
+				std::atomic<std::atomic<member_stats*>*>& page = pages[index / page_size];
+				if (!page.load(std::memory_order_relaxed))
+					page.store(new std::atomic<member_stats*>[page_size]{}, std::memory_order_release);
+				member_stats* created = new member_stats{};
+				page.load(std::memory_order_relaxed)[index % page_size].store(created, std::memory_order_release);
+				return *created;
 			}
-			if constexpr (std::is_same_v<jshort, array_element_type>)
+
+			std::atomic<std::atomic<member_stats*>*> pages[page_count]{};
+		};
+		inline per_thread<thread_shard> _shards{};
+
+		inline void _add(std::atomic<uint64_t>& counter, uint64_t value)
+		{
+			counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed); // single writer
+		}
+
+		inline void _record(const member_site& site, uint64_t ns)
+		{
+			if (site.index >= thread_shard::page_size * thread_shard::page_count) return;
+			member_stats& stats = _shards.get().get(site.index);
+			_add(stats.count, 1);
+			_add(stats.total_ns, ns);
+			if (ns > stats.max_ns.load(std::memory_order_relaxed))
+				stats.max_ns.store(ns, std::memory_order_relaxed);
+			_add(stats.buckets[_bucket_of(ns)], 1);
+		}
+
+		struct summary
+		{
+			const member_site* site;
+			std::string klass_name;
+			uint64_t count;
+			uint64_t total_ns;
+			uint64_t max_ns;
+			uint64_t p50_ns; // percentiles are bucket upper bounds
+			uint64_t p90_ns;
+			uint64_t p99_ns;
+			uint64_t p999_ns;
+		};
+
+		inline std::vector<summary> collect() // every thread merged, sorted by total time
+		{
+			std::vector<member_site*> sites{};
 			{
-				object = get_env()->NewShortArray((jsize)values.size());
-				get_env()->SetShortArrayRegion((jshortArray)object, 0, (jsize)values.size(), values.data());
+				std::lock_guard lock{ _member_sites_mutex };
+				sites = _member_sites();
 			}
-			if constexpr (std::is_same_v<jint, array_element_type>)
+			std::vector<summary> result{};
+			std::vector<uint64_t> buckets(histogram_buckets);
+			for (member_site* site : sites)
 			{
-				object = get_env()->NewIntArray((jsize)values.size());
-				get_env()->SetIntArrayRegion((jintArray)object, 0, (jsize)values.size(), values.data());
+				summary merged{};
+				merged.site = site;
+				std::fill(buckets.begin(), buckets.end(), 0);
+				_shards.for_each([&](thread_shard& shard)
+				{
+					member_stats* stats = shard.find(site->index);
+					if (!stats) return;
+					merged.count += stats->count.load(std::memory_order_relaxed);
+					merged.total_ns += stats->total_ns.load(std::memory_order_relaxed);
+					merged.max_ns = (std::max)(merged.max_ns, stats->max_ns.load(std::memory_order_relaxed));
+					for (uint32_t i = 0; i < histogram_buckets; ++i)
+						buckets[i] += stats->buckets[i].load(std::memory_order_relaxed);
+				});
+				if (!merged.count) continue;
+				auto percentile = [&](double fraction)
+				{
+					uint64_t target = (uint64_t)(fraction * (double)merged.count), seen = 0;
+					for (uint32_t i = 0; i < histogram_buckets; ++i)
+						if ((seen += buckets[i]) > target) return (std::min)(_bucket_upper_bound(i), merged.max_ns);
+					return merged.max_ns;
+				};
+				merged.p50_ns = percentile(0.5);
+				merged.p90_ns = percentile(0.9);
+				merged.p99_ns = percentile(0.99);
+				merged.p999_ns = percentile(0.999);
+				merged.klass_name = site->klass_name;
+				result.push_back(std::move(merged));
 			}
-			if constexpr (std::is_same_v<jfloat, array_element_type>)
+			std::sort(result.begin(), result.end(), [](const summary& a, const summary& b) { return a.total_ns > b.total_ns; });
+			return result;
+		}
+
+		inline void dump(std::ostream& out = std::cout)
+		{
+			out << "calls\ttotal(us)\tp50(ns)\tp90(ns)\tp99(ns)\tp99.9(ns)\tmax(ns)\tmember\n";
+			for (const summary& s : collect())
 			{
-				object = get_env()->NewFloatArray((jsize)values.size());
-				get_env()->SetFloatArrayRegion((jfloatArray)object, 0, (jsize)values.size(), values.data());
+				out << s.count << '\t' << s.total_ns / 1000 << '\t' << s.p50_ns << '\t' << s.p90_ns << '\t' << s.p99_ns << '\t' << s.p999_ns << '\t' << s.max_ns << '\t'
+					<< (s.klass_name.empty() ? "?" : s.klass_name) << '.' << s.site->name << ' ' << s.site->signature << (s.site->is_static ? " static" : "") << '\n';
 			}
-			if constexpr (std::is_same_v<jlong, array_element_type>)
-			{
-				object = get_env()->NewLongArray((jsize)values.size());
-				get_env()->SetLongArrayRegion((jlongArray)object, 0, (jsize)values.size(), values.data());
+		}
+	}
+#endif
+
+#ifdef METAJNI_CALL_TRACE
+	namespace trace
+	{
+		// binary file written by jni::trace::start, convert it with tools/trace_to_json.cpp
+		// "MJNITRC2" then records, each starting with a record_type byte, native endianness:
+		// site:   uint32 index, uint8 is_static, uint16 size + klass name, uint16 size + name, uint16 size + signature
+		// clock:  uint64 ticks, uint64 steady_clock ns, to convert ticks to time
+		// events: uint64 thread id, uint64 dropped events so far, uint32 count, count * event
+		inline constexpr char file_magic[8] = { 'M', 'J', 'N', 'I', 'T', 'R', 'C', '2' };
+		enum record_type : uint8_t
+		{
+			SITE_RECORD = 1,
+			CLOCK_RECORD = 2,
+			EVENTS_RECORD = 3
+		};
+
+		struct event
+		{
+			uint64_t start_ticks;
+			uint64_t end_ticks;
+			uint32_t site_index;
+			uint32_t exception; // a java exception was pending after the call
+		};
+
+		inline constexpr uint64_t ring_size = 1 << 14; // events per thread, recording drops events when the ring is full
+		// a ring is 24 bytes * ring_size (~393 KB) per thread that made a call while tracing, the ring of an exited thread is reused by the next new thread once flushed
+
+		inline uint64_t _ticks()
+		{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+			return __rdtsc();
+#else
+			return _timestamp_ns();
+#endif
+		}
+
+		inline uint64_t _current_thread_id()
+		{
+#ifdef _WIN32
+			return GetCurrentThreadId();
+#elif __linux__
+			return (uint64_t)syscall(SYS_gettid);
+#endif
+		}
+
+		struct ring // single producer (its thread) single consumer (the flusher)
+		{
+			uint64_t thread_id = _current_thread_id();
+			std::atomic<uint64_t> head{ 0 };
+			std::atomic<uint64_t> tail{ 0 };
+			std::atomic<uint64_t> dropped{ 0 };
+			event events[ring_size];
+
+			bool recycle() // by per_thread, for a new thread, the events of the exited one must have been written first
+			{
+				if (head.load(std::memory_order_relaxed) != tail.load(std::memory_order_acquire)) return false;
+				thread_id = _current_thread_id();
+				dropped.store(0, std::memory_order_relaxed);
+				return true;
+			}
+		};
+		inline per_thread<ring, true> _rings{};
+		inline std::atomic<bool> _active{ false };
+
+		inline void _record(const member_site& site, uint64_t start_ticks, uint64_t end_ticks, bool exception)
+		{
+			ring& r = _rings.get();
+			uint64_t head = r.head.load(std::memory_order_relaxed);
+			if (head - r.tail.load(std::memory_order_acquire) >= ring_size)
+			{
+				r.dropped.store(r.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				return;
+			}
+			r.events[head & (ring_size - 1)] = { start_ticks, end_ticks, site.index, exception };
+			r.head.store(head + 1, std::memory_order_release);
+		}
+
+		struct _writer
+		{
+			FILE* file = nullptr;
+			uint32_t flush_interval_ms = 100;
+			size_t sites_written = 0;
+			std::atomic<bool> stop_requested{ false };
+#ifdef _WIN32
+			HANDLE thread = nullptr;
+#elif __linux__
+			pthread_t thread{};
+#endif
+
+			template<class T> void write(const T& value)
+			{
+				fwrite(&value, sizeof(T), 1, file);
+			}
+
+			void write_string(const char* str)
+			{
+				uint16_t size = (uint16_t)std::string_view(str).size();
+				write(size);
+				fwrite(str, 1, size, file);
+			}
+
+			void write_clock()
+			{
+				write(CLOCK_RECORD);
+				write(_ticks());
+				write(_timestamp_ns());
+			}
+
+			void flush()
+			{
+				{
+					std::lock_guard lock{ _member_sites_mutex };
+					for (; sites_written < _member_sites().size(); ++sites_written)
+					{
+						member_site* site = _member_sites()[sites_written];
+						write(SITE_RECORD);
+						write(site->index);
+						write((uint8_t)site->is_static);
+						write_string(site->klass_name);
+						write_string(site->name);
+						write_string(site->signature);
+					}
+				}
+				_rings.for_each([this](ring& r)
+				{
+					uint64_t tail = r.tail.load(std::memory_order_relaxed);
+					uint64_t head = r.head.load(std::memory_order_acquire);
+					if (head == tail) return;
+					write(EVENTS_RECORD);
+					write(r.thread_id);
+					write(r.dropped.load(std::memory_order_relaxed));
+					write((uint32_t)(head - tail));
+					for (; tail != head; ++tail)
+						write(r.events[tail & (ring_size - 1)]);
+					r.tail.store(head, std::memory_order_release);
+				});
+				write_clock();
+				fflush(file);
+			}
+
+			void run()
+			{
+				while (!stop_requested.load(std::memory_order_relaxed))
+				{
+					std::this_thread::sleep_for(std::chrono::milliseconds(flush_interval_ms));
+					flush();
+				}
+			}
+
+#ifdef _WIN32
+			static DWORD WINAPI run_thread(LPVOID self)
+			{
+				((_writer*)self)->run();
+				return 0;
+			}
+#elif __linux__
+			static void* run_thread(void* self)
+			{
+				((_writer*)self)->run();
+				return nullptr;
+			}
+#endif
+		};
+		inline _writer _trace_writer{};
+
+		inline bool start(const char* path, uint32_t flush_interval_ms = 100) // starts recording and a background thread flushing the rings to path
+		{
+			if (_trace_writer.file) return false;
+			_trace_writer.file = fopen(path, "wb");
+			if (!_trace_writer.file) return false;
+			_trace_writer.flush_interval_ms = flush_interval_ms;
+			_trace_writer.sites_written = 0;
+			_trace_writer.stop_requested = false;
+			fwrite(file_magic, 1, sizeof(file_magic), _trace_writer.file);
+			_trace_writer.write_clock();
+#ifdef _WIN32
+			_trace_writer.thread = CreateThread(nullptr, 0, _writer::run_thread, &_trace_writer, 0, nullptr);
+#elif __linux__
+			pthread_create(&_trace_writer.thread, nullptr, _writer::run_thread, &_trace_writer);
+#endif
+			_active = true;
+			return true;
+		}
+
+		inline void stop() // stops recording, flushes everything left and closes the file
+		{
+			if (!_trace_writer.file) return;
+			_active = false;
+			_trace_writer.stop_requested = true;
+#ifdef _WIN32
+			WaitForSingleObject(_trace_writer.thread, INFINITE);
+			CloseHandle(_trace_writer.thread);
+#elif __linux__
+			pthread_join(_trace_writer.thread, nullptr);
+#endif
+			_trace_writer.flush();
+			fclose(_trace_writer.file);
+			_trace_writer.file = nullptr;
+		}
+	}
+#endif
+
+#ifdef METAJNI_GC_STATS
+	namespace gc
+	{
+		// pauses are reported by jni::jvmti::gc_monitor (meta_jvmti.hpp) from the GC callbacks, where only lock-free code is allowed
+		// timestamps are _timestamp_ns(), the clock of jni::stats, jni::trace files store their tick to ns conversion
+		struct pause
+		{
+			uint64_t start_ns;
+			uint64_t end_ns;
+		};
+
+		struct gc_stats
+		{
+			uint64_t pauses;
+			uint64_t pause_total_ns;
+			uint64_t pause_max_ns;
+			uint64_t calls; // wrapped field gets / sets and method calls
+			uint64_t overlapping_calls; // calls during which a pause started or ended
+			uint64_t overlapping_call_ns; // total duration of the overlapping calls
+		};
+
+		inline constexpr uint32_t pause_log_size = 256; // most recent pauses kept by get_pauses
+
+		inline std::atomic<uint64_t> _epoch{ 0 }; // incremented when a pause starts and when it ends, odd during a pause
+		inline std::atomic<uint64_t> _pause_count{ 0 };
+		inline std::atomic<uint64_t> _pause_total_ns{ 0 };
+		inline std::atomic<uint64_t> _pause_max_ns{ 0 };
+		inline std::atomic<uint64_t> _pause_start_ns{ 0 };
+		inline std::atomic<uint64_t> _pause_log_start[pause_log_size]{};
+		inline std::atomic<uint64_t> _pause_log_end[pause_log_size]{};
+
+		struct thread_calls // single writer
+		{
+			std::atomic<uint64_t> calls{ 0 };
+			std::atomic<uint64_t> overlapping{ 0 };
+			std::atomic<uint64_t> overlapping_ns{ 0 };
+		};
+		inline per_thread<thread_calls> _calls{};
+
+		inline void _pause_started() // one GC thread at a time, the VM serializes pauses
+		{
+			_pause_start_ns.store(_timestamp_ns(), std::memory_order_relaxed);
+			_epoch.fetch_add(1, std::memory_order_release);
+		}
+
+		inline void _pause_finished()
+		{
+			uint64_t end_ns = _timestamp_ns();
+			uint64_t start_ns = _pause_start_ns.load(std::memory_order_relaxed);
+			uint64_t index = _pause_count.load(std::memory_order_relaxed);
+			_pause_log_start[index % pause_log_size].store(start_ns, std::memory_order_relaxed);
+			_pause_log_end[index % pause_log_size].store(end_ns, std::memory_order_relaxed);
+			_pause_total_ns.store(_pause_total_ns.load(std::memory_order_relaxed) + end_ns - start_ns, std::memory_order_relaxed);
+			if (end_ns - start_ns > _pause_max_ns.load(std::memory_order_relaxed))
+				_pause_max_ns.store(end_ns - start_ns, std::memory_order_relaxed);
+			_pause_count.store(index + 1, std::memory_order_release);
+			_epoch.fetch_add(1, std::memory_order_release);
+		}
+
+		inline void _record_call(uint64_t start_epoch, uint64_t ns)
+		{
+			thread_calls& calls = _calls.get();
+			calls.calls.store(calls.calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			if (start_epoch == _epoch.load(std::memory_order_acquire) && !(start_epoch & 1)) return;
+			calls.overlapping.store(calls.overlapping.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			calls.overlapping_ns.store(calls.overlapping_ns.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+		}
+
+		inline gc_stats get_stats() // every thread merged
+		{
+			gc_stats result{ _pause_count.load(std::memory_order_acquire), _pause_total_ns.load(std::memory_order_relaxed), _pause_max_ns.load(std::memory_order_relaxed), 0, 0, 0 };
+			_calls.for_each([&](thread_calls& calls)
+			{
+				result.calls += calls.calls.load(std::memory_order_relaxed);
+				result.overlapping_calls += calls.overlapping.load(std::memory_order_relaxed);
+				result.overlapping_call_ns += calls.overlapping_ns.load(std::memory_order_relaxed);
+			});
+			return result;
+		}
+
+		inline std::vector<pause> get_pauses() // up to pause_log_size most recent pauses, oldest first
+		{
+			uint64_t count = _pause_count.load(std::memory_order_acquire);
+			uint64_t first = count > pause_log_size ? count - pause_log_size : 0;
+			std::vector<pause> result{};
+			for (uint64_t i = first; i < count; ++i)
+				result.push_back({ _pause_log_start[i % pause_log_size].load(std::memory_order_relaxed), _pause_log_end[i % pause_log_size].load(std::memory_order_relaxed) });
+			return result;
+		}
+
+		inline void report(std::ostream& out)
+		{
+			gc_stats s = get_stats();
+			out << "gc pauses " << s.pauses << ", total " << s.pause_total_ns / 1000 << "us, max " << s.pause_max_ns / 1000 << "us; wrapped calls " << s.calls
+				<< ", overlapping a pause " << s.overlapping_calls << " (" << s.overlapping_call_ns / 1000 << "us)\n";
+		}
+	}
+#endif
+
+	enum _probe_operation
+	{
+		FIELD_GET,
+		FIELD_SET,
+		METHOD_CALL
+	};
+
+	template<_probe_operation operation>
+	struct _member_probe // RAII around one wrapped JNI operation of a jni::field / jni::method, empty unless an instrumentation layer is enabled
+	{
+#if defined(METAJNI_CALL_STATS) || defined(METAJNI_CALL_TRACE) || (defined(METAJNI_USDT) && defined(__linux__))
+		explicit _member_probe(member_site* site) : // null for a member ID that isn't cached, only the GC layer records it
+			site(site)
+		{
+#if defined(METAJNI_USDT) && defined(__linux__)
+			if (!site) return;
+			if constexpr (operation == FIELD_GET)
+				METAJNI_PROBE(field__get__entry, site->klass_name, site->name, site->signature, get_env());
+			if constexpr (operation == FIELD_SET)
+				METAJNI_PROBE(field__set__entry, site->klass_name, site->name, site->signature, get_env());
+			if constexpr (operation == METHOD_CALL)
+				METAJNI_PROBE(method__call__entry, site->klass_name, site->name, site->signature, get_env());
+#endif
+		}
+
+		member_site* site;
+#else
+		explicit _member_probe(member_site*)
+		{
+		}
+#endif
+#ifdef METAJNI_GC_STATS
+		uint64_t gc_epoch = gc::_epoch.load(std::memory_order_acquire);
+#endif
+#if defined(METAJNI_CALL_STATS) || defined(METAJNI_GC_STATS)
+		uint64_t start_ns = _timestamp_ns();
+#endif
+#ifdef METAJNI_CALL_TRACE
+		uint64_t start_ticks = trace::_active.load(std::memory_order_relaxed) ? trace::_ticks() : 0; // rdtsc is slow in some VMs, not read while stopped
+#endif
+#if defined(METAJNI_CALL_STATS) || defined(METAJNI_GC_STATS) || defined(METAJNI_CALL_TRACE) || (defined(METAJNI_USDT) && defined(__linux__))
+		~_member_probe()
+		{
+#if defined(METAJNI_USDT) && defined(__linux__)
+			if constexpr (operation == FIELD_GET)
+				if (site) METAJNI_PROBE(field__get__return, site->klass_name, site->name, site->signature, get_env());
+			if constexpr (operation == FIELD_SET)
+				if (site) METAJNI_PROBE(field__set__return, site->klass_name, site->name, site->signature, get_env());
+			if constexpr (operation == METHOD_CALL)
+				if (site) METAJNI_PROBE(method__call__return, site->klass_name, site->name, site->signature, get_env());
+#endif
+#if defined(METAJNI_CALL_STATS) || defined(METAJNI_GC_STATS)
+			uint64_t duration_ns = _timestamp_ns() - start_ns;
+#endif
+#ifdef METAJNI_CALL_STATS
+			if (site) stats::_record(*site, duration_ns);
+#endif
+#ifdef METAJNI_GC_STATS
+			gc::_record_call(gc_epoch, duration_ns);
+#endif
+#ifdef METAJNI_CALL_TRACE
+			if (site && start_ticks && trace::_active.load(std::memory_order_relaxed))
+				trace::_record(*site, start_ticks, trace::_ticks(), get_env()->ExceptionCheck() == JNI_TRUE);
+#endif
+		}
+#endif
+	};
+
+	class name_mapper // translates the names written in the mappings (klass, field and method names, signatures) to the names of the running game, see meta_mappings.hpp
+	{
+	public:
+		virtual ~name_mapper() = default;
+		virtual std::string class_name(const char* class_name) const = 0; // internal names, "net/minecraft/Foo"
+		virtual std::string descriptor(const char* descriptor) const = 0;
+		virtual std::string member_name(jclass owner_klass, const char* name, const char* mapped_descriptor, bool is_method) const = 0;
+	};
+	inline std::shared_mutex _name_mapper_mutex{};
+	inline std::shared_ptr<const name_mapper> _name_mapper{}; // a replaced mapper is released when the last resolution using it returns
+
+	inline std::shared_ptr<const name_mapper> _current_name_mapper()
+	{
+		std::shared_lock lock{ _name_mapper_mutex };
+		return _name_mapper;
+	}
+
+	inline void _set_name_mapper(std::shared_ptr<const name_mapper> mapper)
+	{
+		std::unique_lock lock{ _name_mapper_mutex };
+		_name_mapper.swap(mapper); // the previous one is released after the lock, by the last resolution still using it
+	}
+
+	inline std::string _mapped_class_name(const char* class_name)
+	{
+		std::shared_ptr<const name_mapper> mapper = _current_name_mapper();
+		return mapper ? mapper->class_name(class_name) : std::string(class_name);
+	}
+
+	template<class resolver_type>
+	inline auto _resolve_member(jclass owner_klass, const char* name, const char* signature, bool is_method, resolver_type&& resolve) // resolve(name, signature) with the mapped names
+	{
+		std::shared_ptr<const name_mapper> mapper = _current_name_mapper();
+		if (!mapper) return resolve(name, signature);
+		std::string mapped_signature = mapper->descriptor(signature);
+		std::string mapped_name = mapper->member_name(owner_klass, name, mapped_signature.c_str(), is_method);
+		return resolve(mapped_name.c_str(), mapped_signature.c_str());
+	}
+
+	inline jfieldID _resolve_field_id(jclass owner_klass, const char* name, const char* signature, bool is_static) // shared by every jni::field, its resolve_id only forwards its name and signature
+	{
+		jfieldID resolved = _resolve_member(owner_klass, name, signature, false, [&](const char* mapped_name, const char* mapped_signature)
+		{
+			return is_static ? get_env()->GetStaticFieldID(owner_klass, mapped_name, mapped_signature) : get_env()->GetFieldID(owner_klass, mapped_name, mapped_signature);
+		});
+		assertm(resolved, "failed to find fieldID: " << name << ' ' << signature);
+		return resolved;
+	}
+
+	inline jmethodID _resolve_method_id(jclass owner_klass, const char* name, const char* signature, bool is_static)
+	{
+		jmethodID resolved = _resolve_member(owner_klass, name, signature, true, [&](const char* mapped_name, const char* mapped_signature)
+		{
+			return is_static ? get_env()->GetStaticMethodID(owner_klass, mapped_name, mapped_signature) : get_env()->GetMethodID(owner_klass, mapped_name, mapped_signature);
+		});
+		assertm(resolved, "failed to find methodID: " << name << ' ' << signature);
+		return resolved;
+	}
+
+	// class invalidation: every invalidation increments _class_epoch, caches store the epoch they were validated at
+	// a cache from an older epoch is re-resolved if its class name was invalidated since, otherwise it's just revalidated
+	// a superseded class keeps its global ref until jni::shutdown, there is at most one per invalidation and klass type
+	inline std::atomic<uint32_t> _class_epoch{ 1 };
+	inline std::atomic<uint32_t> _all_classes_invalidated_epoch{ 0 };
+	inline std::mutex _invalidated_classes_mutex{};
+	inline std::unordered_map<std::string, uint32_t> _invalidated_classes{}; // class name -> epoch of its last invalidation
+
+	inline void invalidate_class(std::string_view class_name) // internal name, when the class it resolves to changed: klasses of this name resolve their class and member IDs again when next constructed
+	{
+		std::lock_guard lock{ _invalidated_classes_mutex };
+		_invalidated_classes.insert_or_assign(std::string(class_name), _class_epoch.fetch_add(1, std::memory_order_acq_rel) + 1);
+	}
+
+	inline void invalidate_all_classes()
+	{
+		std::lock_guard lock{ _invalidated_classes_mutex };
+		_all_classes_invalidated_epoch.store(_class_epoch.fetch_add(1, std::memory_order_acq_rel) + 1, std::memory_order_relaxed);
+	}
+
+	inline bool _is_class_invalidated(const char* class_name, uint32_t since_epoch)
+	{
+		std::lock_guard lock{ _invalidated_classes_mutex };
+		if (_all_classes_invalidated_epoch.load(std::memory_order_relaxed) > since_epoch) return true;
+		auto it = _invalidated_classes.find(class_name);
+		return it != _invalidated_classes.end() && it->second > since_epoch;
+	}
+
+	struct _class_names // of a class currently cached by a klass type or a class_loader
+	{
+		const char* name; // as written in the mappings
+		std::string mapped_name;
+		uint64_t generation; // unique per registration, the jclass of a destroyed class_loader can be reused by another class
+	};
+	inline std::mutex _current_classes_mutex{};
+	inline std::unordered_map<jclass, _class_names> _current_classes{}; // the class currently cached by each klass type and class_loader, members cache IDs of these only
+	inline uint64_t _class_generation = 0; // under _current_classes_mutex
+
+	inline void _set_current_class(jclass klass_object, const char* name, std::string mapped_name)
+	{
+		std::lock_guard lock{ _current_classes_mutex };
+		auto [it, inserted] = _current_classes.try_emplace(klass_object);
+		if (inserted) it->second.generation = ++_class_generation; // a registered ref isn't released, the same jclass is the same class
+		it->second.name = name;
+		it->second.mapped_name = std::move(mapped_name);
+	}
+
+	inline void _remove_current_class(jclass klass_object)
+	{
+		std::lock_guard lock{ _current_classes_mutex };
+		_current_classes.erase(klass_object);
+	}
+
+	inline bool _is_current_class(jclass klass_object)
+	{
+		std::lock_guard lock{ _current_classes_mutex };
+		return _current_classes.contains(klass_object);
+	}
+
+	struct _current_class_info
+	{
+		uint64_t generation; // 0 if not current
+		const char* name; // as written in the mappings
+	};
+
+	inline _current_class_info _get_current_class_info(jclass klass_object)
+	{
+		std::lock_guard lock{ _current_classes_mutex };
+		auto it = _current_classes.find(klass_object);
+		return it != _current_classes.end() ? _current_class_info{ it->second.generation, it->second.name } : _current_class_info{ 0, "" };
+	}
+
+	inline bool _is_current_class_since(jclass klass_object, uint64_t generation, uint32_t since_epoch) // still the same current class, and its names weren't invalidated since the epoch
+	{
+		std::lock_guard lock{ _current_classes_mutex };
+		auto it = _current_classes.find(klass_object);
+		return it != _current_classes.end() && it->second.generation == generation
+			&& !_is_class_invalidated(it->second.name, since_epoch) && !_is_class_invalidated(it->second.mapped_name.c_str(), since_epoch);
+	}
+
+	template<class T> inline constexpr char _type_key = 0; // its address identifies T
+
+	class class_loader // a java ClassLoader whose classes klasses can be resolved from, see jni::class_loader_scope
+	{
+	public:
+		explicit class_loader(jobject loader_instance)
+		{
+			JNIEnv* env = get_env();
+			if (!env || !loader_instance) return;
+			loader = env->NewGlobalRef(loader_instance);
+			jclass loader_klass = _track_local_ref(env->FindClass("java/lang/ClassLoader"));
+			load_class = env->GetMethodID(loader_klass, "loadClass", "(Ljava/lang/String;)Ljava/lang/Class;");
+			delete_local_ref(loader_klass);
+			assertm(load_class, "failed to find ClassLoader.loadClass");
+		}
+
+		~class_loader() // the loader and its classes can be unloaded after this, wrappers created in its scope must not outlive it
+		{
+			for (auto& [type, klass_object] : klasses)
+			{
+				_remove_current_class(klass_object);
+				delete_global_ref(klass_object);
+			}
+			if (loader) delete_global_ref(loader);
+			if (!klasses.empty()) _class_epoch.fetch_add(1, std::memory_order_acq_rel); // member IDs of its classes revalidate, and aren't found current anymore
+		}
+
+		class_loader(const class_loader&) = delete;
+		class_loader& operator=(const class_loader&) = delete;
+
+		jobject get() const
+		{
+			return loader;
+		}
+
+		jclass find_class(const char* class_name) const // internal name like FindClass ("net/minecraft/Foo"), local ref, one loadClass up-call
+		{
+			JNIEnv* env = get_env();
+			if (!env || !loader || !load_class) return nullptr;
+			std::string binary_name = class_name;
+			std::replace(binary_name.begin(), binary_name.end(), '/', '.');
+			jstring name = _track_local_ref(env->NewStringUTF(binary_name.c_str()));
+			jclass found = _track_local_ref((jclass)env->CallObjectMethod(loader, load_class, name));
+			delete_local_ref(name);
+			if (env->ExceptionCheck())
+			{
+				env->ExceptionClear();
+				return nullptr;
+			}
+			return found;
+		}
+
+		template<class klass_type>
+		jclass get_cached_jclass() // resolved once per loader and klass type
+		{
+			const void* type = &_type_key<klass_type>;
+			{
+				std::shared_lock shared_lock{ mutex };
+				auto it = klasses.find(type);
+				if (it != klasses.end()) return it->second;
+			}
+			static constexpr auto name = klass_type::get_name();
+			std::string mapped_name = _mapped_class_name(name);
+			jclass local = find_class(mapped_name.c_str());
+			jclass found = local ? (jclass)get_env()->NewGlobalRef(local) : nullptr;
+			delete_local_ref(local);
+			assertm(found, (const char*)(concat<"failed to load class: ", klass_type::get_name()>()));
+			std::unique_lock unique_lock{ mutex };
+			auto [it, inserted] = klasses.try_emplace(type, found);
+			if (!inserted && found) delete_global_ref(found); // resolved by another thread meanwhile
+			else if (found) _set_current_class(found, name, std::move(mapped_name)); // its member IDs are cached with the other classes'
+			return it->second;
+		}
+
+		static class_loader* current() // of the calling thread, null outside of a class_loader_scope
+		{
+			return _scope_count.load(std::memory_order_relaxed) ? (class_loader*)_tls_get(_current_slot().index) : nullptr;
+		}
+	private:
+		friend class class_loader_scope;
+
+		struct tls_slot // TLS index holding the current loader, allocated on first use
+		{
+			tls_slot()
+			{
+#ifdef _WIN32
+				index = TlsAlloc();
+#elif __linux__
+				pthread_key_create(&index, nullptr);
+#endif
+			}
+			uint32_t index = 0;
+		};
+
+		static tls_slot& _current_slot()
+		{
+			static tls_slot slot{};
+			return slot;
+		}
+
+		jobject loader = nullptr;
+		jmethodID load_class = nullptr;
+		mutable std::shared_mutex mutex{};
+		std::unordered_map<const void*, jclass> klasses{};
+		inline static std::atomic<uint32_t> _scope_count{ 0 }; // threads skip the TLS read while no scope exists
+	};
+
+	class class_loader_scope // klasses constructed on this thread while the scope lives resolve their classes from loader
+	{
+	public:
+		explicit class_loader_scope(class_loader& loader) :
+			previous((class_loader*)_tls_get(class_loader::_current_slot().index))
+		{
+			class_loader::_scope_count.fetch_add(1, std::memory_order_relaxed);
+			_tls_set(class_loader::_current_slot().index, &loader);
+		}
+
+		~class_loader_scope()
+		{
+			_tls_set(class_loader::_current_slot().index, previous);
+			class_loader::_scope_count.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		class_loader_scope(const class_loader_scope&) = delete;
+		class_loader_scope& operator=(const class_loader_scope&) = delete;
+	private:
+		class_loader* previous;
+	};
+
+	template<typename klass_type> struct jclass_cache
+	{
+		inline static std::mutex mutex{};
+		inline static std::atomic<jclass> value{ nullptr }; // stored before epoch, so a reader that sees an epoch sees its class
+		inline static std::atomic<uint32_t> epoch{ 0 };
+	};
+
+	template<typename klass_type> inline jclass _resolve_jclass() //findClass
+	{
+		JNIEnv* env = get_env();
+		if (!env) return nullptr;
+		using cache = jclass_cache<klass_type>;
+		std::lock_guard lock{ cache::mutex };
+		static constexpr auto name = klass_type::get_name();
+		uint32_t epoch = _class_epoch.load(std::memory_order_acquire);
+		jclass cached = cache::value.load(std::memory_order_relaxed);
+		uint32_t cached_epoch = cache::epoch.load(std::memory_order_relaxed);
+		if (cached && cached_epoch == epoch) return cached;
+		std::string mapped_name = _mapped_class_name(name);
+		if (cached && !_is_class_invalidated(name, cached_epoch) && !_is_class_invalidated(mapped_name.c_str(), cached_epoch))
+		{
+			cache::epoch.store(epoch, std::memory_order_release);
+			return cached;
+		}
+		METAJNI_PROBE(class__resolve__entry, (const char*)name, "", "", env);
+		jclass local = nullptr;
+		if (auto indexed_find_class = _indexed_find_class.load(std::memory_order_acquire))
+			local = _track_local_ref(indexed_find_class(env, mapped_name.c_str()));
+		if (!local)
+		{
+			local = _track_local_ref(env->FindClass(mapped_name.c_str()));
+			if (env->ExceptionCheck())
+				env->ExceptionClear();
+		}
+		jclass candidate = local;
+		if (!candidate && _custom_find_class)
+			candidate = _custom_find_class(mapped_name.c_str()); // its ref stays owned by the custom find class
+		jclass found = cached && candidate && env->IsSameObject(candidate, cached) ? cached : (jclass)env->NewGlobalRef(candidate); // a redefined class is the same object, keep its ref
+		delete_local_ref(local);
+		assertm(found, (const char*)(concat<"failed to find class: ", klass_type::get_name()>()));
+		if (found != cached)
+		{
+			if (cached) _remove_current_class(cached); // its ref stays in _refs_to_delete until jni::shutdown, wrappers and member IDs created before still use it
+			std::lock_guard refs_lock{ _refs_to_delete_mutex };
+			_refs_to_delete.push_back(found);
+		}
+		if (found) _set_current_class(found, name, std::move(mapped_name));
+		cache::value.store(found, std::memory_order_relaxed);
+		cache::epoch.store(epoch, std::memory_order_release);
+		METAJNI_PROBE(class__resolve__return, (const char*)name, "", "", env);
+		return found;
+	}
+
+	template<typename klass_type> inline jclass get_cached_jclass()
+	{
+		if (class_loader* loader = class_loader::current()) [[unlikely]]
+			return loader->get_cached_jclass<klass_type>();
+		using cache = jclass_cache<klass_type>;
+		if (cache::epoch.load(std::memory_order_acquire) == _class_epoch.load(std::memory_order_relaxed)) [[likely]]
+			return cache::value.load(std::memory_order_relaxed);
+		return _resolve_jclass<klass_type>();
+	}
+
+	template<class id_type>
+	struct _member_info // what the ID cache of a field / method needs of it, strings are static
+	{
+		const char* name;
+		const char* signature;
+		bool is_static;
+		id_type(*resolve)(jclass owner_klass);
+	};
+
+	template<class id_type>
+	struct _resolved_member
+	{
+		id_type id;
+		member_site* site; // of the member in the klass of the owner, null if the ID isn't cached
+	};
+
+	template<class id_type>
+	class _member_id_cache // IDs of a field / method per owner class (a member declared in a base klass has one per derived klass, a class_loader's classes have their own)
+	{
+	public:
+		_resolved_member<id_type> get(jclass owner_klass, const _member_info<id_type>& member)
+		{
+			const entry* cached = hot.load(std::memory_order_acquire); // the first owner used in the epoch, most members only ever have one
+			if (cached && cached->owner == owner_klass && cached->epoch.load(std::memory_order_relaxed) == _class_epoch.load(std::memory_order_relaxed)) [[likely]]
+				return { cached->id, cached->site };
+			return get_shared(owner_klass, member);
+		}
+	private:
+		struct entry // only its epoch changes, entries are freed with the cache so readers need no lock
+		{
+			jclass owner;
+			id_type id;
+			member_site* site;
+			uint64_t generation; // of the owner in _current_classes
+			std::atomic<uint32_t> epoch; // _class_epoch it was last validated at
+		};
+
+		struct table // open addressing on the owner, slots are filled or replaced under the mutex and read without it
+		{
+			explicit table(uint32_t capacity) :
+				mask(capacity - 1),
+				slots(new std::atomic<entry*>[capacity]{})
+			{
+			}
+
+			uint32_t slot_of(jclass owner_klass) const // the slot of the owner, or the free one it goes to, never full (see insert)
+			{
+				for (uint32_t i = (uint32_t)(((uint64_t)(uintptr_t)owner_klass * 0x9E3779B97F4A7C15ull) >> 32) & mask;; i = (i + 1) & mask)
+				{
+					entry* found = slots[i].load(std::memory_order_acquire);
+					if (!found || found->owner == owner_klass) return i;
+				}
+			}
+
+			entry* find(jclass owner_klass) const
+			{
+				return slots[slot_of(owner_klass)].load(std::memory_order_acquire);
+			}
+
+			uint32_t mask;
+			uint32_t used = 0;
+			std::unique_ptr<std::atomic<entry*>[]> slots;
+		};
+
+		_resolved_member<id_type> get_shared(jclass owner_klass, const _member_info<id_type>& member) // not a template of the member, only one copy per id type
+		{
+			if (!owner_klass) return {};
+			uint32_t current_epoch = _class_epoch.load(std::memory_order_acquire);
+			if (const table* owners = current_table.load(std::memory_order_acquire))
+			{
+				const entry* found = owners->find(owner_klass);
+				if (found && found->epoch.load(std::memory_order_relaxed) == current_epoch) return { found->id, found->site };
+			}
+			std::lock_guard lock{ mutex };
+			current_epoch = _class_epoch.load(std::memory_order_acquire);
+			table* owners = current_table.load(std::memory_order_relaxed);
+			entry* found = owners ? owners->find(owner_klass) : nullptr;
+			if (found && found->epoch.load(std::memory_order_relaxed) != current_epoch)
+			{
+				if (_is_current_class_since(owner_klass, found->generation, found->epoch.load(std::memory_order_relaxed)))
+					found->epoch.store(current_epoch, std::memory_order_relaxed);
+				else
+					found = nullptr; // replaced by a new entry, readers may still hold it
+			}
+			if (!found)
+			{
+				_current_class_info owner = _get_current_class_info(owner_klass);
+				id_type id = member.resolve(owner_klass);
+				if (!id || !owner.generation) return { id, nullptr }; // a class replaced since the wrapper was created, not cached
+				member_site* site = &_get_member_site(owner.name, member.name, member.signature, member.is_static);
+				found = entries.emplace_back(new entry{ owner_klass, id, site, owner.generation, current_epoch }).get();
+				insert(found);
+			}
+			const entry* hot_entry = hot.load(std::memory_order_relaxed);
+			if (!hot_entry || hot_entry->owner == owner_klass || hot_entry->epoch.load(std::memory_order_relaxed) != current_epoch)
+				hot.store(found, std::memory_order_release);
+			return { found->id, found->site };
+		}
+
+		void insert(entry* added) // under the mutex
+		{
+			table* owners = current_table.load(std::memory_order_relaxed);
+			if (owners && (owners->used + 1) * 2 <= owners->mask + 1)
+			{
+				uint32_t slot = owners->slot_of(added->owner);
+				if (!owners->slots[slot].load(std::memory_order_relaxed)) ++owners->used;
+				owners->slots[slot].store(added, std::memory_order_release); // a new owner, or a new entry of a replaced one
+				return;
+			}
+			table* grown = tables.emplace_back(new table(owners ? (owners->mask + 1) * 2 : 4)).get(); // at half full, the previous table stays readable
+			for (uint32_t i = 0; owners && i <= owners->mask; ++i)
+				if (entry* moved = owners->slots[i].load(std::memory_order_relaxed); moved && moved->owner != added->owner)
+				{
+					grown->slots[grown->slot_of(moved->owner)].store(moved, std::memory_order_relaxed);
+					++grown->used;
+				}
+			grown->slots[grown->slot_of(added->owner)].store(added, std::memory_order_relaxed);
+			++grown->used;
+			current_table.store(grown, std::memory_order_release);
+		}
+
+		std::atomic<const entry*> hot{ nullptr };
+		std::atomic<table*> current_table{ nullptr }; // every owner, for the members used with several
+		std::mutex mutex{};
+		std::vector<std::unique_ptr<entry>> entries{}; // every entry created, replaced ones included
+		std::vector<std::unique_ptr<table>> tables{}; // every table, grown ones included
+	};
+
+	struct local_ref // the jobject is stored as is, it dies with its JNI frame
+	{
+		static constexpr bool is_global = false;
+
+		static jobject acquire(jobject object_instance)
+		{
+			return object_instance;
+		}
+
+		static jobject convert(jobject object_instance) // from another ownership, the wrapper gets its own local ref
+		{
+			return object_instance ? _track_local_ref(get_env()->NewLocalRef(object_instance)) : nullptr;
+		}
+
+		static void release([[maybe_unused]] jobject object_instance)
+		{
+		}
+	};
+
+	struct global_ref // global refs aren't destroyed on PopLocalFrame, and can be shared between threads
+	{
+		static constexpr bool is_global = true;
+
+		static jobject acquire(jobject object_instance)
+		{
+			return object_instance ? get_env()->NewGlobalRef(object_instance) : nullptr;
+		}
+
+		static jobject convert(jobject object_instance)
+		{
+			return acquire(object_instance);
+		}
+
+		static void release(jobject object_instance)
+		{
+			delete_global_ref(object_instance); // deferred, also works on threads without a JNIEnv
+		}
+	};
+
+	class object_wrapper // only holds the jobject, ownership is handled by jni::klass / jni::array through their ref_policy
+	{
+	public:
+		object_wrapper(jobject object_instance) :
+			object_instance(object_instance)
+		{
+		}
+
+		bool operator==(const object_wrapper& other) const
+		{
+			return is_same_object(other);
+		}
+
+		bool is_same_object(const object_wrapper& other) const
+		{
+			return get_env()->IsSameObject(object_instance, other.object_instance) == JNI_TRUE;
+		}
+
+		template<typename klass_type>
+		bool is_instance_of() const
+		{
+			return get_env()->IsInstanceOf(object_instance, get_cached_jclass<klass_type>()) == JNI_TRUE;
+		}
+
+		operator jobject() const
+		{
+			return this->object_instance;
+		}
+
+		operator bool() const
+		{
+			return this->object_instance;
+		}
+
+		jobject object_instance;
+	};
+
+	struct empty_members : public object_wrapper
+	{
+		empty_members(jclass owner_klass, jobject object_instance) :
+			object_wrapper(object_instance),
+			owner_klass(owner_klass)
+		{
+		}
+
+		jclass owner_klass;
+	};
+
+	template<typename T, typename... U> inline constexpr bool is_any_of_type = (std::is_same_v<T, U> || ...);
+	template<typename T> inline constexpr bool is_jni_primitive_type = is_any_of_type<T, jboolean, jbyte, jchar, jshort, jint, jfloat, jlong, jdouble>;
+
+	template<class wrapper_type>
+	class object_parameter // accepts a wrapper_type (or a subclass) under any ownership, so global wrappers can be passed where the mappings expect locals
+	{
+	public:
+		object_parameter(const typename wrapper_type::base_type& object) :
+			object_instance(object.object_instance)
+		{
+		}
+
+		object_parameter(std::nullptr_t) :
+			object_instance(nullptr)
+		{
+		}
+
+		object_parameter(jobject object_instance) :
+			object_instance(object_instance)
+		{
+		}
+
+		operator jobject() const
+		{
+			return object_instance;
+		}
+	private:
+		jobject object_instance;
+	};
+
+	template<class T> using parameter_t = std::conditional_t<is_jni_primitive_type<T>, T, object_parameter<T>>;
+
+	enum is_static_t : bool
+	{
+		STATIC = true,
+		NOT_STATIC = false
+	};
+
+	template<class T> using _argument_t = std::conditional_t<is_jni_primitive_type<T>, T, jobject>; // what goes in a jvalue
+
+	// one call thunk per return kind, shared by every jni::method: a method's call only packs its arguments in jvalues and loads its id (keeps big mappings small)
+#define METAJNI_CALL_THUNK(type, java_name) \
+	inline type _call_##java_name##_thunk(jclass owner_klass, jobject object_instance, jmethodID id, bool is_static, const jvalue* arguments) \
+	{ \
+		if (!id || !owner_klass || (!is_static && !object_instance)) return type(); \
+		if (is_static) return get_env()->CallStatic##java_name##MethodA(owner_klass, id, arguments); \
+		return get_env()->Call##java_name##MethodA(object_instance, id, arguments); \
+	}
+
+	METAJNI_CALL_THUNK(void, Void)
+	METAJNI_CALL_THUNK(jobject, Object)
+
+	inline jvalue _to_jvalue(jobject value)
+	{
+		return jvalue{ .l = value };
+	}
+
+	template<class T>
+	struct _jni_type // JNIEnv functions used for a java type, one specialization per primitive instead of if constexpr ladders (keeps big mappings fast to compile), this one is for objects (jni::klass, jni::array)
+	{
+		using value_type = jobject;
+		static constexpr auto get_field = &JNIEnv_::GetObjectField;
+		static constexpr auto get_static_field = &JNIEnv_::GetStaticObjectField;
+		static constexpr auto set_field = &JNIEnv_::SetObjectField;
+		static constexpr auto set_static_field = &JNIEnv_::SetStaticObjectField;
+#ifdef METAJNI_VARARGS_CALLS
+		static constexpr auto call_method = &JNIEnv_::CallObjectMethod;
+		static constexpr auto call_static_method = &JNIEnv_::CallStaticObjectMethod;
+#endif
+		static constexpr auto call_thunk = &_call_Object_thunk;
+
+		static T empty()
+		{
+			return T(nullptr);
+		}
+
+		static T wrap(jobject object_instance, member_site* site) // object_instance is the local ref returned by JNI
+		{
+			T wrapped(_track_local_ref(object_instance, site));
+			if constexpr (T::is_global())
+				delete_local_ref(object_instance); // promoted to a global ref by the constructor
+			return wrapped;
+		}
+	};
+
+	template<>
+	struct _jni_type<void>
+	{
+		static constexpr auto signature = string_litteral("V");
+#ifdef METAJNI_VARARGS_CALLS
+		static constexpr auto call_method = &JNIEnv_::CallVoidMethod;
+		static constexpr auto call_static_method = &JNIEnv_::CallStaticVoidMethod;
+#endif
+		static constexpr auto call_thunk = &_call_Void_thunk;
+
+		static constexpr void empty()
+		{
+		}
+	};
+
+#ifdef METAJNI_VARARGS_CALLS
+	#define METAJNI_VARARGS_TRAITS(java_name) \
+		static constexpr auto call_method = &JNIEnv_::Call##java_name##Method; \
+		static constexpr auto call_static_method = &JNIEnv_::CallStatic##java_name##Method;
+#else
+	#define METAJNI_VARARGS_TRAITS(java_name)
+#endif
+
+#define METAJNI_PRIMITIVE_TYPE(type, java_name, type_signature, jvalue_member) \
+	METAJNI_CALL_THUNK(type, java_name) \
+	inline jvalue _to_jvalue(type value) { return jvalue{ .jvalue_member = value }; } \
+	template<> \
+	struct _jni_type<type> \
+	{ \
+		using value_type = type; \
+		using array_type = type##Array; \
+		static constexpr auto signature = string_litteral(type_signature); \
+		static constexpr auto get_field = &JNIEnv_::Get##java_name##Field; \
+		static constexpr auto get_static_field = &JNIEnv_::GetStatic##java_name##Field; \
+		static constexpr auto set_field = &JNIEnv_::Set##java_name##Field; \
+		static constexpr auto set_static_field = &JNIEnv_::SetStatic##java_name##Field; \
+		METAJNI_VARARGS_TRAITS(java_name) \
+		static constexpr auto call_thunk = &_call_##java_name##_thunk; \
+		static constexpr auto new_array = &JNIEnv_::New##java_name##Array; \
+		static constexpr auto get_array_region = &JNIEnv_::Get##java_name##ArrayRegion; \
+		static constexpr auto set_array_region = &JNIEnv_::Set##java_name##ArrayRegion; \
+		static constexpr type empty() { return type(0); } \
+		static constexpr type wrap(type value, member_site*) { return value; } \
+	};
+
+	METAJNI_PRIMITIVE_TYPE(jboolean, Boolean, "Z", z)
+	METAJNI_PRIMITIVE_TYPE(jbyte, Byte, "B", b)
+	METAJNI_PRIMITIVE_TYPE(jchar, Char, "C", c)
+	METAJNI_PRIMITIVE_TYPE(jshort, Short, "S", s)
+	METAJNI_PRIMITIVE_TYPE(jint, Int, "I", i)
+	METAJNI_PRIMITIVE_TYPE(jfloat, Float, "F", f)
+	METAJNI_PRIMITIVE_TYPE(jlong, Long, "J", j)
+	METAJNI_PRIMITIVE_TYPE(jdouble, Double, "D", d)
+#undef METAJNI_PRIMITIVE_TYPE
+#undef METAJNI_VARARGS_TRAITS
+#undef METAJNI_CALL_THUNK
+
+	template<class T> inline constexpr auto get_signature_for_type()
+	{
+		if constexpr (std::is_void_v<T> || is_jni_primitive_type<T>)
+			return _jni_type<T>::signature;
+		else
+			return T::get_signature();
+	}
+
+	inline constexpr jsize bulk_chunk_size = 64; // elements converted per local frame by bulk array helpers
+
+	inline const char* _to_modified_utf8(std::string_view str, std::string& buffer) // what NewStringUTF expects from UTF-8: U+0000 as C0 80, 4 byte characters as two 3 byte surrogates
+	{
+		if (std::find_if(str.begin(), str.end(), [](char c) { return c == 0 || (unsigned char)c >= 0xF0; }) == str.end())
+		{
+			buffer.assign(str); // most strings, no conversion
+			return buffer.c_str();
+		}
+		buffer.clear();
+		for (size_t i = 0; i < str.size(); ++i)
+		{
+			unsigned char c = (unsigned char)str[i];
+			if (c == 0)
+				buffer.append("\xC0\x80", 2);
+			else if (c >= 0xF0 && c <= 0xF4 && i + 3 < str.size())
+			{
+				uint32_t code_point = ((c & 0x07u) << 18) | ((str[i + 1] & 0x3Fu) << 12) | ((str[i + 2] & 0x3Fu) << 6) | (str[i + 3] & 0x3Fu);
+				for (uint32_t unit : { 0xD800 + ((code_point - 0x10000) >> 10), 0xDC00 + ((code_point - 0x10000) & 0x3FF) })
+				{
+					buffer += (char)(0xE0 | (unit >> 12));
+					buffer += (char)(0x80 | ((unit >> 6) & 0x3F));
+					buffer += (char)(0x80 | (unit & 0x3F));
+				}
+				i += 3;
+			}
+			else
+				buffer += (char)c; // invalid sequences are passed as is, like before
+		}
+		return buffer.c_str();
+	}
+
+	class string_arena // every string of a String[] stored back to back in one buffer
+	{
+	public:
+		size_t size() const
+		{
+			return offsets.size() - 1;
+		}
+
+		std::string_view operator[](size_t index) const // a null element reads as an empty string, see at() / is_null()
+		{
+			return std::string_view(bytes.data() + offsets[index], offsets[index + 1] - offsets[index]);
+		}
+
+		std::optional<std::string_view> at(size_t index) const // nullopt for a null element
+		{
+			if (is_null(index)) return std::nullopt;
+			return (*this)[index];
+		}
+
+		bool is_null(size_t index) const
+		{
+			return nulls[index];
+		}
+
+		std::vector<std::string_view> views() const // views are invalidated when the arena is destroyed
+		{
+			std::vector<std::string_view> result{};
+			result.reserve(size());
+			for (size_t i = 0; i < size(); ++i)
+				result.push_back((*this)[i]);
+			return result;
+		}
+
+		std::vector<std::string> to_vector() const
+		{
+			std::vector<std::string> result{};
+			result.reserve(size());
+			for (size_t i = 0; i < size(); ++i)
+				result.emplace_back((*this)[i]);
+			return result;
+		}
+
+		std::string bytes{};
+		std::vector<size_t> offsets{ 0 }; // string i is bytes[offsets[i], offsets[i + 1])
+		std::vector<bool> nulls{}; // element i of the array was null, its string is empty
+	};
+
+	template<class array_element_type>
+	class basic_array : public object_wrapper // everything that doesn't depend on the ownership of the array ref
+	{
+	public:
+		basic_array(jobject object_instance) :
+			object_wrapper(object_instance)
+		{
+		}
+
+		std::vector<array_element_type> to_vector() const
+		{
+			[[maybe_unused]] static constexpr auto signature = get_signature();
+			METAJNI_PROBE(array__to__vector__entry, (const char*)signature, "to_vector", "", get_env());
+			jsize length = get_length();
+			std::vector<array_element_type> vector{};
+			vector.reserve(length);
+			if constexpr (!is_jni_primitive_type<array_element_type>)
+			{
+				for (jsize i = 0; i < length; ++i)
+				{
+					jobject element = _track_local_ref<basic_array>(get_env()->GetObjectArrayElement((jobjectArray)object_instance, i));
+					vector.push_back( array_element_type(element) );
+					if constexpr (array_element_type::is_global())
+						delete_local_ref(element); // promoted to a global ref by the constructor
+				}
+			}
+			else
+			{
+				vector.resize(length);
+				(get_env()->*_jni_type<array_element_type>::get_array_region)((typename _jni_type<array_element_type>::array_type)object_instance, 0, length, vector.data());
+			}
+			METAJNI_PROBE(array__to__vector__return, (const char*)signature, "to_vector", "", get_env());
+			return vector;
+		}
+
+		static constexpr bool is_string_array = std::string_view(get_signature_for_type<array_element_type>()) == "Ljava/lang/String;";
+
+		string_arena to_strings() const requires is_string_array
+		{
+			string_arena arena{};
+			if (!object_instance) return arena;
+			JNIEnv* env = get_env();
+			jsize length = get_length();
+			arena.offsets.reserve((size_t)length + 1);
+			arena.nulls.reserve((size_t)length);
+			for (jsize chunk_start = 0; chunk_start < length; chunk_start += bulk_chunk_size)
+			{
+				frame chunk_frame{ bulk_chunk_size }; // element refs die with the chunk instead of piling up
+				jsize chunk_end = (length - chunk_start < bulk_chunk_size ? length : chunk_start + bulk_chunk_size);
+				for (jsize i = chunk_start; i < chunk_end; ++i)
+				{
+					jstring str_obj = (jstring)_track_local_ref<basic_array>(env->GetObjectArrayElement((jobjectArray)object_instance, i));
+					if (const char* chars = str_obj ? env->GetStringUTFChars(str_obj, nullptr) : nullptr) // one copy out of the VM, modified UTF-8 has no embedded zero byte
+					{
+						arena.bytes.append(chars);
+						env->ReleaseStringUTFChars(str_obj, chars);
+					}
+					arena.offsets.push_back(arena.bytes.size());
+					arena.nulls.push_back(!str_obj);
+				}
+			}
+			return arena;
+		}
+
+		jsize get_length() const
+		{
+			return get_env()->GetArrayLength((jarray)object_instance);
+		}
+
+		static constexpr auto get_signature()
+		{
+			return concat<"[", get_signature_for_type<array_element_type>()>();
+		}
+
+		static constexpr auto get_name() //this is used for FindClass
+		{
+			return get_signature();
+		}
+
+		static member_site& get_site()
+		{
+			return get_member_site<"", "array elements", get_signature()>();
+		}
+	};
+
+	template<class array_element_type, class ref_policy = local_ref>
+	class array : public basic_array<array_element_type>
+	{
+	public:
+		using base_type = basic_array<array_element_type>;
+		using local = array<array_element_type, local_ref>;
+		using global = array<array_element_type, global_ref>;
+
+		array(jobject object_instance) :
+			base_type(ref_policy::acquire(object_instance))
+		{
+		}
+
+		array(const array& other) :
+			array(other.object_instance)
+		{
+		}
+
+		array(array&& other) noexcept :
+			base_type(other.object_instance)
+		{
+			other.object_instance = nullptr;
+		}
+
+		template<class other_policy>
+		explicit array(const array<array_element_type, other_policy>& other) : // explicit conversion between ownerships
+			base_type(ref_policy::convert(other.object_instance))
+		{
+		}
+
+		~array()
+		{
+			ref_policy::release(this->object_instance);
+		}
+
+		array& operator=(const array& other)
+		{
+			jobject old_instance = this->object_instance; // set before releasing, eg if operator= is called on itself
+			this->object_instance = ref_policy::acquire(other.object_instance);
+			ref_policy::release(old_instance);
+			return *this;
+		}
+
+		array& operator=(array&& other) noexcept
+		{
+			std::swap(this->object_instance, other.object_instance);
+			return *this;
+		}
+
+		template<class other_policy>
+		array& operator=(const array<array_element_type, other_policy>& other) = delete; // no silent aliasing between ownerships, convert explicitly
+
+		void clear_ref()
+		{
+			ref_policy::release(this->object_instance);
+			this->object_instance = nullptr;
+		}
+
+		static constexpr bool is_global()
+		{
+			return ref_policy::is_global;
+		}
+
+		template<class range_type>
+		static array from_strings(const range_type& strings) requires basic_array<array_element_type>::is_string_array
+		{
+			JNIEnv* env = get_env();
+			jsize length = (jsize)std::size(strings);
+			jobjectArray object = _track_local_ref<base_type>(env->NewObjectArray(length, get_cached_jclass<array_element_type>(), nullptr));
+			if (!object) return array(nullptr);
+			std::string buffer{}; // NewStringUTF needs null terminated modified UTF-8, string_views are not
+			auto it = std::begin(strings);
+			for (jsize chunk_start = 0; chunk_start < length; chunk_start += bulk_chunk_size)
+			{
+				frame chunk_frame{ bulk_chunk_size };
+				jsize chunk_end = (length - chunk_start < bulk_chunk_size ? length : chunk_start + bulk_chunk_size);
+				for (jsize i = chunk_start; i < chunk_end; ++i, ++it)
+				{
+					env->SetObjectArrayElement(object, i, _track_local_ref<base_type>(env->NewStringUTF(_to_modified_utf8(std::string_view(*it), buffer))));
+				}
 			}
-			if constexpr (std::is_same_v<jdouble, array_element_type>)
+			return adopt_local(object);
+		}
+
+		static array create(const std::vector<array_element_type>& values)
+		{
+			jobject object = nullptr;
+			if constexpr (!is_jni_primitive_type<array_element_type>)
+			{
+				object = get_env()->NewObjectArray((jsize)values.size(), get_cached_jclass<array_element_type>(), nullptr);
+				for (jsize i = 0; i < values.size(); ++i)
+					get_env()->SetObjectArrayElement((jobjectArray)object, i, (jobject)values[i]);
+			}
+			else
 			{
-				object = get_env()->NewDoubleArray((jsize)values.size());
-				get_env()->SetDoubleArrayRegion((jdoubleArray)object, 0, (jsize)values.size(), values.data());
+				using traits = _jni_type<array_element_type>;
+				object = (get_env()->*traits::new_array)((jsize)values.size());
+				(get_env()->*traits::set_array_region)((typename traits::array_type)object, 0, (jsize)values.size(), values.data());
 			}
-			return array(object);
+			return adopt_local(_track_local_ref<base_type>(object));
+		}
+	private:
+		static array adopt_local(jobject local_instance) // wraps a local ref created here, a global array doesn't keep it
+		{
+			array result(local_instance);
+			if constexpr (ref_policy::is_global)
+				delete_local_ref(local_instance);
+			return result;
 		}
 	};
 
+	template<class member_type> inline constexpr auto precomputed_signature = nullptr; // specialized for a jni::field / jni::method by headers generated with metajni-gen --signatures, the signature isn't built from the types then
+	// the specialization must be seen before the member's signature is used, in every translation unit using the member: include the generated header first, METAJNI_CHECK_SIGNATURES compares it with the types
+	template<class member_type> inline constexpr bool has_precomputed_signature = !std::is_null_pointer_v<std::remove_cv_t<decltype(precomputed_signature<member_type>)>>;
+
 	template<typename field_type, string_litteral field_name, is_static_t is_static = NOT_STATIC>
 	class field
 	{
 	public:
-		field(const empty_members& m) :
+		explicit field(const empty_members& m) : // only the reference, the ID is resolved on first use and shared in ids
 			m(m)
 		{
-			if (id) return;
-			if constexpr (is_static)
-				id = get_env()->GetStaticFieldID(m.owner_klass, get_name(), get_signature());
-			if constexpr (!is_static)
-				id = get_env()->GetFieldID(m.owner_klass, get_name(), get_signature());
-			assertm(id, (const char*)(concat<"failed to find fieldID: ", get_name(), " ", get_signature()>()));
 		}
 
 		field(const field& other) = delete; // make sure field won't be copied (we store a empty_members reference which must not be copied)
 
-		field& operator=(const field_type& new_value)
+		field& operator=(const parameter_t<field_type>& new_value)
 		{
 			set(new_value);
 			return *this;
 		}
 
-		void set(const field_type& new_value)
+		void set(const parameter_t<field_type>& new_value)
 		{
-			if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return;
-			if constexpr (!is_jni_primitive_type<field_type>)
-			{
-				if constexpr (is_static)
-					return get_env()->SetStaticObjectField(m.owner_klass, id, (jobject)new_value);
-				if constexpr (!is_static)
-					return get_env()->SetObjectField(m.object_instance, id, (jobject)new_value);
-			}
-			if constexpr (std::is_same_v<jboolean, field_type>)
-			{
-				if constexpr (is_static)
-					return get_env()->SetStaticBooleanField(m.owner_klass, id, new_value);
-				if constexpr (!is_static)
-					return get_env()->SetBooleanField(m.object_instance, id, new_value);
-			}
-			if constexpr (std::is_same_v<jbyte, field_type>)
-			{
-				if constexpr (is_static)
-					return get_env()->SetStaticByteField(m.owner_klass, id, new_value);
-				if constexpr (!is_static)
-					return get_env()->SetByteField(m.object_instance, id, new_value);
-			}
-			if constexpr (std::is_same_v<jchar, field_type>)
-			{
-				if constexpr (is_static)
-					return get_env()->SetStaticCharField(m.owner_klass, id, new_value);
-				if constexpr (!is_static)
-					return get_env()->SetCharField(m.object_instance, id, new_value);
-			}
-			if constexpr (std::is_same_v<jshort, field_type>)
-			{
-				if constexpr (is_static)
-					return get_env()->SetStaticShortField(m.owner_klass, id, new_value);
-				if constexpr (!is_static)
-					return get_env()->SetShortField(m.object_instance, id, new_value);
-			}
-			if constexpr (std::is_same_v<jint, field_type>)
-			{
-				if constexpr (is_static)
-					return get_env()->SetStaticIntField(m.owner_klass, id, new_value);
-				if constexpr (!is_static)
-					return get_env()->SetIntField(m.object_instance, id, new_value);
-			}
-			if constexpr (std::is_same_v<jfloat, field_type>)
-			{
-				if constexpr (is_static)
-					return get_env()->SetStaticFloatField(m.owner_klass, id, new_value);
-				if constexpr (!is_static)
-					return get_env()->SetFloatField(m.object_instance, id, new_value);
-			}
-			if constexpr (std::is_same_v<jlong, field_type>)
-			{
-				if constexpr (is_static)
-					return get_env()->SetStaticLongField(m.owner_klass, id, new_value);
-				if constexpr (!is_static)
-					return get_env()->SetLongField(m.object_instance, id, new_value);
-			}
-			if constexpr (std::is_same_v<jdouble, field_type>)
-			{
-				if constexpr (is_static)
-					return get_env()->SetStaticDoubleField(m.owner_klass, id, new_value);
-				if constexpr (!is_static)
-					return get_env()->SetDoubleField(m.object_instance, id, new_value);
-			}
+			if (!m.owner_klass || (!is_static && !m.object_instance)) return;
+			_resolved_member<jfieldID> member = resolve();
+			if (!member.id) return;
+			[[maybe_unused]] _member_probe<FIELD_SET> probe{ member.site };
+			using traits = _jni_type<field_type>;
+			if constexpr (is_static)
+				(get_env()->*traits::set_static_field)(m.owner_klass, member.id, (typename traits::value_type)new_value);
+			else
+				(get_env()->*traits::set_field)(m.object_instance, member.id, (typename traits::value_type)new_value);
 		}
 
 		auto get() const
 		{
-			if constexpr (!is_jni_primitive_type<field_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return field_type(nullptr);
-				if constexpr (is_static)
-					return field_type(get_env()->GetStaticObjectField(m.owner_klass, id));
-				if constexpr (!is_static)
-					return field_type(get_env()->GetObjectField(m.object_instance, id));
-			}
-			if constexpr (std::is_same_v<jboolean, field_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return jboolean(JNI_FALSE);
-				if constexpr (is_static)
-					return get_env()->GetStaticBooleanField(m.owner_klass, id);
-				if constexpr (!is_static)
-					return get_env()->GetBooleanField(m.object_instance, id);
-			}
-			if constexpr (std::is_same_v<jbyte, field_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return jbyte(0);
-				if constexpr (is_static)
-					return get_env()->GetStaticByteField(m.owner_klass, id);
-				if constexpr (!is_static)
-					return get_env()->GetByteField(m.object_instance, id);
-			}
-			if constexpr (std::is_same_v<jchar, field_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return jchar(0);
-				if constexpr (is_static)
-					return get_env()->GetStaticCharField(m.owner_klass, id);
-				if constexpr (!is_static)
-					return get_env()->GetCharField(m.object_instance, id);
-			}
-			if constexpr (std::is_same_v<jshort, field_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return jshort(0);
-				if constexpr (is_static)
-					return get_env()->GetStaticShortField(m.owner_klass, id);
-				if constexpr (!is_static)
-					return get_env()->GetShortField(m.object_instance, id);
-			}
-			if constexpr (std::is_same_v<jint, field_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return jint(0);
-				if constexpr (is_static)
-					return get_env()->GetStaticIntField(m.owner_klass, id);
-				if constexpr (!is_static)
-					return get_env()->GetIntField(m.object_instance, id);
-			}
-			if constexpr (std::is_same_v<jfloat, field_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return jfloat(0.f);
-				if constexpr (is_static)
-					return get_env()->GetStaticFloatField(m.owner_klass, id);
-				if constexpr (!is_static)
-					return get_env()->GetFloatField(m.object_instance, id);
-			}
-			if constexpr (std::is_same_v<jlong, field_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return jlong(0LL);
-				if constexpr (is_static)
-					return get_env()->GetStaticLongField(m.owner_klass, id);
-				if constexpr (!is_static)
-					return get_env()->GetLongField(m.object_instance, id);
-			}
-			if constexpr (std::is_same_v<jdouble, field_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return jdouble(0.0);
-				if constexpr (is_static)
-					return get_env()->GetStaticDoubleField(m.owner_klass, id);
-				if constexpr (!is_static)
-					return get_env()->GetDoubleField(m.object_instance, id);
-			}
+			using traits = _jni_type<field_type>;
+			if (!m.owner_klass || (!is_static && !m.object_instance)) return traits::empty();
+			_resolved_member<jfieldID> member = resolve();
+			if (!member.id) return traits::empty();
+			[[maybe_unused]] _member_probe<FIELD_GET> probe{ member.site };
+			if constexpr (is_static)
+				return traits::wrap((get_env()->*traits::get_static_field)(m.owner_klass, member.id), member.site);
+			else
+				return traits::wrap((get_env()->*traits::get_field)(m.object_instance, member.id), member.site);
 		}
 
 		operator field_type() const
@@ -604,7 +2245,15 @@ namespace jni
 
 		static constexpr auto get_signature()
 		{
-			return get_signature_for_type<field_type>();
+			if constexpr (has_precomputed_signature<field>)
+			{
+#ifdef METAJNI_CHECK_SIGNATURES
+				static_assert(std::string_view(precomputed_signature<field>) == std::string_view(get_signature_for_type<field_type>()), "precomputed signature doesn't match the field type");
+#endif
+				return precomputed_signature<field>;
+			}
+			else
+				return get_signature_for_type<field_type>();
 		}
 
 		static constexpr bool is_field_static()
@@ -614,11 +2263,24 @@ namespace jni
 
 		operator jfieldID() const
 		{
-			return id;
+			return resolve().id;
 		}
 	private:
+		static jfieldID resolve_id(jclass owner_klass)
+		{
+			return _resolve_field_id(owner_klass, get_name(), get_signature(), is_static);
+		}
+
+		_resolved_member<jfieldID> resolve() const // ID of m.owner_klass, which differs between class loaders
+		{
+			static constexpr auto name = get_name();
+			static constexpr auto signature = get_signature();
+			static constexpr _member_info<jfieldID> info{ name, signature, is_static, &resolve_id };
+			return ids.get(m.owner_klass, info);
+		}
+
 		const empty_members& m;
-		inline static jfieldID id = nullptr;
+		inline static _member_id_cache<jfieldID> ids{};
 	};
 
 
@@ -626,114 +2288,49 @@ namespace jni
 	class method
 	{
 	public:
-		method(const empty_members& m) :
+		explicit method(const empty_members& m) : // only the reference, the ID is resolved on first use and shared in ids
 			m(m)
 		{
-			if (id) return;
-			if constexpr (is_static)
-				id = get_env()->GetStaticMethodID(m.owner_klass, get_name(), get_signature());
-			if constexpr (!is_static)
-				id = get_env()->GetMethodID(m.owner_klass, get_name(), get_signature());
-			assertm(id, (const char*)(concat<"failed to find methodID: ", get_name(), " ", get_signature()>()));
 		}
 
 		method(const method& other) = delete; // make sure method won't be copied (we store a empty_members reference which must not be copied)
 
-		auto operator()(const method_parameters_type&... method_parameters) const
+		auto operator()(const parameter_t<method_parameters_type>&... method_parameters) const
 		{
 			return call(method_parameters...);
 		}
 
-		auto call(const method_parameters_type&... method_parameters) const
+		auto call(const parameter_t<method_parameters_type>&... method_parameters) const
 		{
+			using traits = _jni_type<method_return_type>;
+			_resolved_member<jmethodID> member = m.owner_klass ? resolve() : _resolved_member<jmethodID>{};
+			jmethodID id = member.id;
+			[[maybe_unused]] _member_probe<METHOD_CALL> probe{ member.site };
+#ifndef METAJNI_VARARGS_CALLS
+			const jvalue arguments[sizeof...(method_parameters_type) + 1] = { _to_jvalue(_argument_t<method_parameters_type>(method_parameters))... }; // + 1, no zero sized arrays
+			if constexpr (std::is_void_v<method_return_type>)
+				traits::call_thunk(m.owner_klass, m.object_instance, id, is_static, arguments);
+			else
+				return traits::wrap(traits::call_thunk(m.owner_klass, m.object_instance, id, is_static, arguments), member.site);
+#else // previous dispatch, one varargs call per method and return type, kept to compare code size (metajni_size_report)
+			if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return traits::empty();
 			if constexpr (std::is_void_v<method_return_type>)
 			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return;
-				if constexpr (is_static)
-					get_env()->CallStaticVoidMethod(m.owner_klass, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
-				if constexpr (!is_static)
-					get_env()->CallVoidMethod(m.object_instance, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
-				return;
-			}
-
-			if constexpr (!is_jni_primitive_type<method_return_type> && !std::is_void_v<method_return_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return method_return_type(nullptr);
-				if constexpr (is_static)
-					return method_return_type(get_env()->CallStaticObjectMethod(m.owner_klass, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...));
-				if constexpr (!is_static)
-					return method_return_type(get_env()->CallObjectMethod(m.object_instance, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...));
-			}
-			if constexpr (std::is_same_v<jboolean, method_return_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return jboolean(JNI_FALSE);
-				if constexpr (is_static)
-					return get_env()->CallStaticBooleanMethod(m.owner_klass, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
-				if constexpr (!is_static)
-					return get_env()->CallBooleanMethod(m.object_instance, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
-			}
-			if constexpr (std::is_same_v<jbyte, method_return_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return jbyte(0);
-				if constexpr (is_static)
-					return get_env()->CallStaticByteMethod(m.owner_klass, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
-				if constexpr (!is_static)
-					return get_env()->CallByteMethod(m.object_instance, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
-			}
-			if constexpr (std::is_same_v<jchar, method_return_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return jchar(0);
-				if constexpr (is_static)
-					return get_env()->CallStaticCharMethod(m.owner_klass, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
-				if constexpr (!is_static)
-					return get_env()->CallCharMethod(m.object_instance, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
-			}
-			if constexpr (std::is_same_v<jshort, method_return_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return jshort(0);
-				if constexpr (is_static)
-					return get_env()->CallStaticShortMethod(m.owner_klass, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
-				if constexpr (!is_static)
-					return get_env()->CallShortMethod(m.object_instance, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
-			}
-			if constexpr (std::is_same_v<jint, method_return_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return jint(0);
-				if constexpr (is_static)
-					return get_env()->CallStaticIntMethod(m.owner_klass, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
-				if constexpr (!is_static)
-					return get_env()->CallIntMethod(m.object_instance, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
-			}
-			if constexpr (std::is_same_v<jfloat, method_return_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return jfloat(0.f);
-				if constexpr (is_static)
-					return get_env()->CallStaticFloatMethod(m.owner_klass, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
-				if constexpr (!is_static)
-					return get_env()->CallFloatMethod(m.object_instance, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
-			}
-			if constexpr (std::is_same_v<jlong, method_return_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return jlong(0LL);
-				if constexpr (is_static)
-					return get_env()->CallStaticLongMethod(m.owner_klass, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
-				if constexpr (!is_static)
-					return get_env()->CallLongMethod(m.object_instance, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
-			}
-			if constexpr (std::is_same_v<jdouble, method_return_type>)
-			{
-				if (!id || !m.owner_klass || (!is_static && !m.object_instance)) return jdouble(0.0);
 				if constexpr (is_static)
-					return get_env()->CallStaticDoubleMethod(m.owner_klass, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
-				if constexpr (!is_static)
-					return get_env()->CallDoubleMethod(m.object_instance, id, std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...);
+					(get_env()->*traits::call_static_method)(m.owner_klass, id, _argument_t<method_parameters_type>(method_parameters)...);
+				else
+					(get_env()->*traits::call_method)(m.object_instance, id, _argument_t<method_parameters_type>(method_parameters)...);
 			}
+			else if constexpr (is_static)
+				return traits::wrap((get_env()->*traits::call_static_method)(m.owner_klass, id, _argument_t<method_parameters_type>(method_parameters)...), member.site);
+			else
+				return traits::wrap((get_env()->*traits::call_method)(m.object_instance, id, _argument_t<method_parameters_type>(method_parameters)...), member.site);
+#endif
 		}
 
-
 		operator jmethodID() const
 		{
-			return id;
+			return resolve().id;
 		}
 
 		static constexpr auto get_name()
@@ -743,7 +2340,15 @@ namespace jni
 
 		static constexpr auto get_signature()
 		{
-			return concat<"(", get_signature_for_type<method_parameters_type>()..., ")", get_signature_for_type<method_return_type>()>();
+			if constexpr (has_precomputed_signature<method>)
+			{
+#ifdef METAJNI_CHECK_SIGNATURES
+				static_assert(std::string_view(precomputed_signature<method>) == std::string_view(concat<"(", get_signature_for_type<method_parameters_type>()..., ")", get_signature_for_type<method_return_type>()>()), "precomputed signature doesn't match the method types");
+#endif
+				return precomputed_signature<method>;
+			}
+			else
+				return concat<"(", get_signature_for_type<method_parameters_type>()..., ")", get_signature_for_type<method_return_type>()>();
 		}
 
 		static constexpr bool is_method_static()
@@ -752,8 +2357,21 @@ namespace jni
 		}
 
 	private:
+		static jmethodID resolve_id(jclass owner_klass)
+		{
+			return _resolve_method_id(owner_klass, get_name(), get_signature(), is_static);
+		}
+
+		_resolved_member<jmethodID> resolve() const // ID of m.owner_klass, which differs between class loaders
+		{
+			static constexpr auto name = get_name();
+			static constexpr auto signature = get_signature();
+			static constexpr _member_info<jmethodID> info{ name, signature, is_static, &resolve_id };
+			return ids.get(m.owner_klass, info);
+		}
+
 		const empty_members& m;
-		inline static jmethodID id;
+		inline static _member_id_cache<jmethodID> ids{};
 	};
 
 
@@ -772,28 +2390,91 @@ namespace jni
 	*/
 
 
-	template<string_litteral class_name, class members_type>
+	template<class wrapper_type> class weak;
+
+	template<string_litteral class_name, class members_type, class ref_policy = local_ref>
 	class klass : public members_type
 	{
 	public:
-		klass(jobject object_instance = nullptr, bool is_global_ref = false) :
-			members_type(get_cached_jclass<klass>(), object_instance, is_global_ref) // be careful order of initialization matters
+		using base_type = members_type;
+		using local = klass<class_name, members_type, local_ref>;
+		using global = klass<class_name, members_type, global_ref>;
+		using weak = jni::weak<local>;
+
+		klass(jobject object_instance = nullptr) :
+			members_type(get_cached_jclass<local>(), ref_policy::acquire(object_instance)) // be careful order of initialization matters
+		{
+		}
+
+		klass(const klass& other) : klass(other.object_instance) {} // very important to not copy jni::field and method
+
+		klass(klass&& other) noexcept :
+			members_type(other.owner_klass, other.object_instance)
 		{
+			other.object_instance = nullptr;
 		}
 
-		klass(const klass& other) : klass(other.object_instance, other.is_global()) {} // very important to not copy jni::field and method
+		template<class other_policy>
+		explicit klass(const klass<class_name, members_type, other_policy>& other) : // explicit conversion between ownerships, eg maps::Minecraft::global(theMinecraft)
+			members_type(other.owner_klass, ref_policy::convert(other.object_instance))
+		{
+		}
+
+		~klass()
+		{
+			ref_policy::release(this->object_instance);
+		}
 
 		klass& operator=(const klass& other) //operator= is not inherited by default
 		{
-			object_wrapper::operator=(other);
+			jobject old_instance = this->object_instance; // set before releasing, eg if operator= is called on itself or on a klass with the same object_instance
+			this->object_instance = ref_policy::acquire(other.object_instance);
+			ref_policy::release(old_instance);
 			return *this;
 		}
-		
+
+		klass& operator=(klass&& other) noexcept
+		{
+			std::swap(this->object_instance, other.object_instance);
+			return *this;
+		}
+
+		template<class other_policy>
+		klass& operator=(const klass<class_name, members_type, other_policy>& other) = delete; // no silent aliasing between ownerships, convert explicitly
+
+		void clear_ref()
+		{
+			ref_policy::release(this->object_instance);
+			this->object_instance = nullptr;
+		}
+
+		static constexpr bool is_global()
+		{
+			return ref_policy::is_global;
+		}
+
+		template<class... method_parameters_type>
+		struct constructor_site // for the local ref stats of new_object
+		{
+			static member_site& get_site()
+			{
+				return get_member_site<class_name, "<init>", jni::constructor<method_parameters_type...>::get_signature()>();
+			}
+		};
+
 		template<class... method_parameters_type>
-		static klass new_object(jni::constructor<method_parameters_type...> members_type::*constructor, const method_parameters_type&... method_parameters) // tbh I was just playing with member pointers
+		static klass new_object(jni::constructor<method_parameters_type...> members_type::*constructor, const parameter_t<method_parameters_type>&... method_parameters) // tbh I was just playing with member pointers
 		{
-			klass tmp{}; //lmao
-			return klass{jni::get_env()->NewObject(get_cached_jclass<klass>(), jmethodID(tmp.*constructor), std::conditional_t<is_jni_primitive_type<method_parameters_type>, method_parameters_type, jobject>(method_parameters)...)};
+			[[maybe_unused]] static constexpr auto name = get_name();
+			[[maybe_unused]] static constexpr auto signature = jni::constructor<method_parameters_type...>::get_signature();
+			METAJNI_PROBE(new__object__entry, (const char*)name, "<init>", (const char*)signature, jni::get_env());
+			local tmp{}; //lmao
+			jobject object_instance = _track_local_ref<constructor_site<method_parameters_type...>>(jni::get_env()->NewObject(get_cached_jclass<local>(), jmethodID(tmp.*constructor), _argument_t<method_parameters_type>(method_parameters)...));
+			klass created{ object_instance };
+			if constexpr (ref_policy::is_global)
+				delete_local_ref(object_instance); // promoted to a global ref by the constructor
+			METAJNI_PROBE(new__object__return, (const char*)name, "<init>", (const char*)signature, jni::get_env());
+			return created;
 		}
 
 		static constexpr auto get_name()
@@ -807,16 +2488,225 @@ namespace jni
 		}
 	};
 
-	class frame
+	template<class wrapper_type> // jni::klass<> or jni::array<>
+	class shared_global // one global ref shared by every copy, copies only touch an atomic counter
 	{
 	public:
-		frame(jint capacity = 16)
+		shared_global() = default;
+
+		explicit shared_global(jobject object_instance) :
+			control(object_instance ? new control_block{ get_env()->NewGlobalRef(object_instance) } : nullptr)
 		{
-			get_env()->PushLocalFrame(capacity);
 		}
-		~frame()
+
+		shared_global(const shared_global& other) :
+			control(other.control)
+		{
+			if (control)
+				control->count.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		shared_global(shared_global&& other) noexcept :
+			control(other.control)
+		{
+			other.control = nullptr;
+		}
+
+		~shared_global()
+		{
+			release();
+		}
+
+		shared_global& operator=(const shared_global& other)
+		{
+			if (other.control)
+				other.control->count.fetch_add(1, std::memory_order_relaxed); // before release, in case of self assignment
+			release();
+			control = other.control;
+			return *this;
+		}
+
+		shared_global& operator=(shared_global&& other) noexcept
+		{
+			if (this == &other) return *this;
+			release();
+			control = other.control;
+			other.control = nullptr;
+			return *this;
+		}
+
+		wrapper_type get() const // unmanaged wrapper, only valid while a shared_global owning the ref lives
+		{
+			return wrapper_type(control ? control->object_instance : nullptr);
+		}
+
+		wrapper_type operator*() const
+		{
+			return get();
+		}
+
+		operator jobject() const
+		{
+			return control ? control->object_instance : nullptr;
+		}
+
+		operator bool() const
+		{
+			return control && control->object_instance;
+		}
+
+		long use_count() const
+		{
+			return control ? control->count.load(std::memory_order_relaxed) : 0;
+		}
+
+		void reset()
+		{
+			release();
+			control = nullptr;
+		}
+	private:
+		struct control_block
+		{
+			jobject object_instance;
+			std::atomic<long> count{ 1 };
+		};
+
+		void release()
+		{
+			if (!control || control->count.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+			delete_global_ref(control->object_instance);
+			delete control;
+		}
+
+		control_block* control = nullptr;
+	};
+
+	template<class wrapper_type> // jni::klass<> or jni::array<>
+	class weak // weak global ref, doesn't prevent the object from being garbage collected
+	{
+	public:
+		weak() = default;
+
+		explicit weak(jobject object_instance) :
+			object_instance(object_instance ? get_env()->NewWeakGlobalRef(object_instance) : nullptr)
+		{
+		}
+
+		weak(const weak& other) :
+			weak(other.object_instance)
+		{
+		}
+
+		weak(weak&& other) noexcept :
+			object_instance(other.object_instance)
+		{
+			other.object_instance = nullptr;
+		}
+
+		~weak()
+		{
+			delete_weak_global_ref(object_instance);
+		}
+
+		weak& operator=(const weak& other)
+		{
+			jweak old_instance = object_instance;
+			object_instance = (other.object_instance ? get_env()->NewWeakGlobalRef(other.object_instance) : nullptr);
+			delete_weak_global_ref(old_instance);
+			return *this;
+		}
+
+		weak& operator=(weak&& other) noexcept
+		{
+			if (this == &other) return *this;
+			delete_weak_global_ref(object_instance);
+			object_instance = other.object_instance;
+			other.object_instance = nullptr;
+			return *this;
+		}
+
+		wrapper_type lock() const // strong ref to the object, null if it has been collected
+		{
+			if (!object_instance) return wrapper_type(nullptr);
+			if constexpr (wrapper_type::is_global())
+				return wrapper_type(object_instance); // NewGlobalRef takes the weak ref directly, no intermediate local ref
+			else
+				return wrapper_type(_track_local_ref(get_env()->NewLocalRef(object_instance)));
+		}
+
+		bool expired() const
+		{
+			return !object_instance || get_env()->IsSameObject(object_instance, nullptr) == JNI_TRUE;
+		}
+
+		void reset()
+		{
+			delete_weak_global_ref(object_instance);
+			object_instance = nullptr;
+		}
+
+		operator jweak() const
+		{
+			return object_instance;
+		}
+	private:
+		jweak object_instance = nullptr;
+	};
+
+	template<class key_type, class wrapper_type, class hash_type = std::hash<key_type>>
+	class weak_cache // remembers wrappers across frames without keeping their objects alive
+	{
+	public:
+		wrapper_type get(const key_type& key) const // null if missing or collected
+		{
+			std::shared_lock shared_lock{ mutex };
+			auto it = entries.find(key);
+			if (it == entries.end()) return wrapper_type(nullptr);
+			return it->second.lock();
+		}
+
+		template<class factory_type>
+		wrapper_type get_or_insert(const key_type& key, factory_type&& factory) // factory is called when the entry is missing or collected
 		{
-			get_env()->PopLocalFrame(nullptr);
+			if (wrapper_type cached = get(key)) return cached;
+			wrapper_type created = factory();
+			put(key, created);
+			return created;
 		}
+
+		void put(const key_type& key, jobject object_instance)
+		{
+			weak<wrapper_type> entry{ object_instance };
+			std::unique_lock unique_lock{ mutex };
+			entries.insert_or_assign(key, std::move(entry));
+		}
+
+		void erase(const key_type& key)
+		{
+			std::unique_lock unique_lock{ mutex };
+			entries.erase(key);
+		}
+
+		size_t purge() // removes collected entries, returns how many were removed
+		{
+			std::unique_lock unique_lock{ mutex };
+			return std::erase_if(entries, [](const auto& entry) { return entry.second.expired(); });
+		}
+
+		size_t size() const
+		{
+			std::shared_lock shared_lock{ mutex };
+			return entries.size();
+		}
+
+		void clear()
+		{
+			std::unique_lock unique_lock{ mutex };
+			entries.clear();
+		}
+	private:
+		mutable std::shared_mutex mutex{};
+		std::unordered_map<key_type, weak<wrapper_type>, hash_type> entries{};
 	};
 }
\ No newline at end of file
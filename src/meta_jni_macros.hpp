@@ -0,0 +1,15 @@
+#pragma once
+
+// the mapping macros alone, meta_jni.hpp includes them, code using import metajni; includes them next to the import (modules don't export macros)
+#define BEGIN_KLASS_DEF(unobf_klass_name, obf_klass_name) struct unobf_klass_name##_members; using unobf_klass_name = jni::klass<obf_klass_name, unobf_klass_name##_members>; struct unobf_klass_name##_members : public jni::empty_members	{ unobf_klass_name##_members(jclass owner_klass, jobject object_instance) : jni::empty_members(owner_klass, object_instance) {}
+
+#define END_KLASS_DEF()	};
+
+#define BEGIN_KLASS_DEF_EX(unobf_klass_name, obf_klass_name, inherit_from) struct unobf_klass_name##_members; using unobf_klass_name = jni::klass<obf_klass_name, unobf_klass_name##_members>; struct unobf_klass_name##_members : public inherit_from##_members { unobf_klass_name##_members(jclass owner_klass, jobject object_instance) : inherit_from##_members(owner_klass, object_instance) {}
+
+#define KLASS_DECLARATION(unobf_klass_name, obf_klass_name) struct unobf_klass_name##_members; using unobf_klass_name = jni::klass<obf_klass_name, unobf_klass_name##_members>;
+#define BEGIN_KLASS_MEMBERS_EX(unobf_klass_name, inherit_from) struct unobf_klass_name##_members : public inherit_from##_members { unobf_klass_name##_members(jclass owner_klass, jobject object_instance) : inherit_from##_members(owner_klass, object_instance) {}
+#define BEGIN_KLASS_MEMBERS(unobf_klass_name) BEGIN_KLASS_MEMBERS_EX(unobf_klass_name, jni::empty)
+#define END_KLASS_MEMBERS()	};
+
+#define JNI_SCOPED_FRAME(frame_name) static jni::frame_site frame_name##_site{}; jni::scoped_frame frame_name{ frame_name##_site }
@@ -0,0 +1,887 @@
+#pragma once
+
+#include "meta_jni.hpp"
+#include <jvmti.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <functional>
+#include <concepts>
+#include <deque>
+#include <optional>
+
+#ifdef __linux__
+	#include <unistd.h>
+#endif
+
+// JVMTI based tools, each component creates its own jvmtiEnv (a JVM supports many) so their callbacks and capabilities don't interfere
+// like the rest of the library, jni::init and jni::set_thread_env must have been called on the calling thread
+namespace jni::jvmti
+{
+	inline jvmtiEnv* create_env(jint version = JVMTI_VERSION_1_2)
+	{
+		JNIEnv* env = get_env();
+		if (!env) return nullptr;
+		JavaVM* vm = nullptr;
+		if (env->GetJavaVM(&vm) != JNI_OK || !vm) return nullptr;
+		jvmtiEnv* jvmti = nullptr;
+		if (vm->GetEnv((void**)&jvmti, version) != JNI_OK) return nullptr;
+		return jvmti;
+	}
+
+	inline std::string take_string(jvmtiEnv* jvmti, char* str) // copies a string allocated by jvmti and deallocates it
+	{
+		if (!str) return std::string();
+		std::string result = str;
+		jvmti->Deallocate((unsigned char*)str);
+		return result;
+	}
+
+	inline std::string signature_to_class_name(std::string_view signature) // "Lnet/minecraft/Foo;" -> "net.minecraft.Foo"
+	{
+		if (signature.size() >= 2 && signature.front() == 'L' && signature.back() == ';')
+			signature = signature.substr(1, signature.size() - 2);
+		std::string name{ signature };
+		std::replace(name.begin(), name.end(), '/', '.');
+		return name;
+	}
+
+	inline std::string get_method_full_name(jvmtiEnv* jvmti, jmethodID method, bool with_signature = true) // "net.minecraft.Foo.bar(I)V"
+	{
+		char* name = nullptr;
+		char* signature = nullptr;
+		if (jvmti->GetMethodName(method, &name, &signature, nullptr) != JVMTI_ERROR_NONE) return "<unknown>";
+		std::string method_name = take_string(jvmti, name);
+		std::string method_signature = take_string(jvmti, signature);
+		jclass declaring_klass = nullptr;
+		char* klass_signature = nullptr;
+		std::string klass_name{};
+		if (jvmti->GetMethodDeclaringClass(method, &declaring_klass) == JVMTI_ERROR_NONE)
+		{
+			if (jvmti->GetClassSignature(declaring_klass, &klass_signature, nullptr) == JVMTI_ERROR_NONE)
+				klass_name = signature_to_class_name(take_string(jvmti, klass_signature));
+			if (JNIEnv* env = get_env()) env->DeleteLocalRef(declaring_klass); // JVMTI callbacks free their local refs on return, other threads don't
+		}
+		return klass_name + '.' + method_name + (with_signature ? method_signature : std::string());
+	}
+
+	class perf_map // writes JIT compiled methods to /tmp/perf-<pid>.map so `perf report` can symbolize java frames
+	{
+	public:
+		static bool start(const char* path = nullptr) // path defaults to /tmp/perf-<pid>.map on linux
+		{
+			jvmtiEnv* started = start_locked(path);
+			if (!started) return false;
+			// replay the code compiled before we attached, without holding the mutex the callbacks take
+			started->GenerateEvents(JVMTI_EVENT_COMPILED_METHOD_LOAD);
+			started->GenerateEvents(JVMTI_EVENT_DYNAMIC_CODE_GENERATED);
+			flush();
+			return true;
+		}
+
+		static void stop() // closing the map flushes it
+		{
+			std::lock_guard lock{ mutex };
+			stop_locked();
+		}
+
+		static void flush() // writes the buffered lines now, eg. before running perf on a live process
+		{
+			std::lock_guard lock{ mutex };
+			if (file) fflush(file);
+		}
+
+		inline static constexpr uint64_t flush_interval_ns = 1'000'000'000; // the map is buffered and flushed by the first line written this long after the previous flush, by flush() and by stop()
+	private:
+		static jvmtiEnv* start_locked(const char* path)
+		{
+			std::lock_guard lock{ mutex };
+			if (jvmti) return nullptr;
+			std::string file_path = path ? path : default_path();
+			if (file_path.empty()) return nullptr;
+			jvmti = create_env();
+			if (!jvmti) return nullptr;
+
+			jvmtiCapabilities capabilities{};
+			capabilities.can_generate_compiled_method_load_events = 1;
+			jvmtiEventCallbacks callbacks{};
+			callbacks.CompiledMethodLoad = compiled_method_load;
+			callbacks.DynamicCodeGenerated = dynamic_code_generated;
+			file = fopen(file_path.c_str(), "w");
+			last_flush_ns = _timestamp_ns();
+			if (!file
+				|| jvmti->AddCapabilities(&capabilities) != JVMTI_ERROR_NONE
+				|| jvmti->SetEventCallbacks(&callbacks, (jint)sizeof(callbacks)) != JVMTI_ERROR_NONE)
+			{
+				stop_locked();
+				return nullptr;
+			}
+			jvmti->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_COMPILED_METHOD_LOAD, nullptr);
+			jvmti->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_DYNAMIC_CODE_GENERATED, nullptr);
+			return jvmti;
+		}
+
+		static std::string default_path()
+		{
+#ifdef __linux__
+			return "/tmp/perf-" + std::to_string(getpid()) + ".map";
+#else
+			return std::string();
+#endif
+		}
+
+		static void stop_locked()
+		{
+			if (jvmti)
+			{
+				jvmti->SetEventNotificationMode(JVMTI_DISABLE, JVMTI_EVENT_COMPILED_METHOD_LOAD, nullptr);
+				jvmti->SetEventNotificationMode(JVMTI_DISABLE, JVMTI_EVENT_DYNAMIC_CODE_GENERATED, nullptr);
+				jvmti->DisposeEnvironment();
+				jvmti = nullptr;
+			}
+			if (file)
+			{
+				fclose(file);
+				file = nullptr;
+			}
+		}
+
+		static void write(const void* address, jint size, const std::string& symbol)
+		{
+			std::lock_guard lock{ mutex };
+			if (!file) return;
+			fprintf(file, "%llx %x %s\n", (unsigned long long)(uintptr_t)address, (unsigned int)size, symbol.c_str());
+			uint64_t now_ns = _timestamp_ns();
+			if (now_ns - last_flush_ns < flush_interval_ns) return;
+			fflush(file); // perf may read the map while we are still running
+			last_flush_ns = now_ns;
+		}
+
+		static void JNICALL compiled_method_load(jvmtiEnv* jvmti_env, jmethodID method, jint code_size, const void* code_addr, [[maybe_unused]] jint map_length, [[maybe_unused]] const jvmtiAddrLocationMap* map, [[maybe_unused]] const void* compile_info)
+		{
+			write(code_addr, code_size, get_method_full_name(jvmti_env, method));
+		}
+
+		static void JNICALL dynamic_code_generated([[maybe_unused]] jvmtiEnv* jvmti_env, const char* name, const void* address, jint length)
+		{
+			write(address, length, std::string("[stub] ") + name);
+		}
+
+		inline static std::mutex mutex{};
+		inline static jvmtiEnv* jvmti = nullptr;
+		inline static FILE* file = nullptr;
+		inline static uint64_t last_flush_ns = 0;
+	};
+
+	struct sampler_options
+	{
+		uint32_t interval_ms = 10;
+		jint max_depth = 64; // frames kept from the leaf, deeper stacks lose their root side
+		bool runnable_only = false; // skip threads that are waiting, sleeping or blocked
+		bool thread_names = true; // root every stack with its thread name
+		std::vector<jthread> threads{}; // samples only these threads (GetThreadListStackTraces), all threads when empty
+	};
+
+	struct sampler_stats
+	{
+		uint64_t samples; // sampling rounds
+		uint64_t stacks; // stacks recorded across all rounds
+		uint64_t unique_stacks;
+		uint64_t sampling_ns; // time spent in the sampler thread taking samples, the cost paid by the JVM threads is the safepoints
+	};
+
+	class sampler // samples the java threads from a background thread, aggregated into folded stacks for flamegraphs
+	{
+	public:
+		static bool start(const sampler_options& options = {})
+		{
+			std::lock_guard lock{ control_mutex };
+			if (running) return false;
+			JNIEnv* env = get_env();
+			if (!env || env->GetJavaVM(&vm) != JNI_OK) return false;
+			if (!jvmti) jvmti = create_env(); // kept after stop to resolve method names in write_folded
+			if (!jvmti) return false;
+			interval_ms = options.interval_ms;
+			max_depth = options.max_depth;
+			runnable_only = options.runnable_only;
+			thread_names = options.thread_names;
+			for (jthread selected : options.threads)
+				threads.push_back((jthread)env->NewGlobalRef(selected));
+			stop_requested = false;
+#ifdef _WIN32
+			thread = CreateThread(nullptr, 0, run_thread, nullptr, 0, nullptr);
+#elif __linux__
+			pthread_create(&thread, nullptr, run_thread, nullptr);
+#endif
+			running = true;
+			return true;
+		}
+
+		static void stop() // stops sampling, the samples are kept until clear()
+		{
+			std::lock_guard lock{ control_mutex };
+			if (!running) return;
+			running = false;
+			stop_requested = true;
+#ifdef _WIN32
+			WaitForSingleObject(thread, INFINITE);
+			CloseHandle(thread);
+#elif __linux__
+			pthread_join(thread, nullptr);
+#endif
+			for (jthread selected : threads)
+				delete_global_ref(selected); // stop may be called from a thread without a JNIEnv
+			threads.clear();
+		}
+
+		static bool write_folded(const char* path) // "thread;root;...;leaf count" lines, input of flamegraph.pl, inferno or speedscope
+		{
+			std::unordered_map<std::string, uint64_t> snapshot{};
+			{
+				std::lock_guard lock{ samples_mutex };
+				snapshot = samples;
+			}
+			std::lock_guard lock{ control_mutex };
+			if (!jvmti) return false;
+			FILE* file = fopen(path, "w");
+			if (!file) return false;
+			std::string line{};
+			for (const auto& [key, count] : snapshot)
+			{
+				size_t name_end = key.find('\0');
+				line.assign(key, 0, name_end);
+				// frames are stored leaf first, folded stacks go root first
+				const jmethodID* frames = (const jmethodID*)(key.data() + name_end + 1);
+				size_t frame_count = (key.size() - name_end - 1) / sizeof(jmethodID);
+				for (size_t i = frame_count; i-- > 0;)
+				{
+					jmethodID method{};
+					memcpy(&method, frames + i, sizeof(method)); // the key bytes aren't aligned
+					if (!line.empty()) line += ';';
+					line += method_name(method);
+				}
+				fprintf(file, "%s %llu\n", line.c_str(), (unsigned long long)count);
+			}
+			fclose(file);
+			return true;
+		}
+
+		static sampler_stats get_stats()
+		{
+			std::lock_guard lock{ samples_mutex };
+			return { sample_count, stack_count, samples.size(), sampling_ns };
+		}
+
+		static void clear()
+		{
+			std::lock_guard lock{ samples_mutex };
+			samples.clear();
+			sample_count = stack_count = sampling_ns = 0;
+		}
+	private:
+#ifdef _WIN32
+		static DWORD WINAPI run_thread(LPVOID)
+		{
+			run();
+			return 0;
+		}
+#elif __linux__
+		static void* run_thread(void*)
+		{
+			run();
+			return nullptr;
+		}
+#endif
+
+		static void run()
+		{
+			JNIEnv* env = nullptr;
+			if (vm->AttachCurrentThreadAsDaemon((void**)&env, nullptr) != JNI_OK) return;
+			std::string key{};
+			while (!stop_requested.load(std::memory_order_relaxed))
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+				uint64_t start_ns = _timestamp_ns();
+				if (env->PushLocalFrame(16) != 0) continue; // frees the thread objects returned by jvmti
+				sample(key);
+				env->PopLocalFrame(nullptr);
+				std::lock_guard lock{ samples_mutex };
+				sampling_ns += _timestamp_ns() - start_ns;
+			}
+			vm->DetachCurrentThread();
+		}
+
+		static void sample(std::string& key)
+		{
+			jvmtiStackInfo* stacks = nullptr;
+			jint thread_count = 0;
+			jvmtiError error = threads.empty()
+				? jvmti->GetAllStackTraces(max_depth, &stacks, &thread_count)
+				: jvmti->GetThreadListStackTraces((jint)threads.size(), threads.data(), max_depth, &stacks);
+			if (error != JVMTI_ERROR_NONE) return;
+			if (!threads.empty()) thread_count = (jint)threads.size();
+
+			std::lock_guard lock{ samples_mutex };
+			++sample_count;
+			for (jint i = 0; i < thread_count; ++i)
+			{
+				const jvmtiStackInfo& stack = stacks[i];
+				if (stack.frame_count == 0) continue; // native threads, including this one
+				if (runnable_only && !(stack.state & JVMTI_THREAD_STATE_RUNNABLE)) continue;
+				key.clear();
+				jvmtiThreadInfo info{};
+				if (thread_names && jvmti->GetThreadInfo(stack.thread, &info) == JVMTI_ERROR_NONE)
+				{
+					key = take_string(jvmti, info.name); // thread group and context class loader are freed by the local frame
+					std::replace(key.begin(), key.end(), ';', '_'); // ';' separates frames
+				}
+				key += '\0';
+				for (jint frame = 0; frame < stack.frame_count; ++frame)
+					key.append((const char*)&stack.frame_buffer[frame].method, sizeof(jmethodID));
+				++samples[key];
+				++stack_count;
+			}
+			jvmti->Deallocate((unsigned char*)stacks);
+		}
+
+		static const std::string& method_name(jmethodID method) // resolved once, jmethodIDs of unloaded classes resolve to <unknown>
+		{
+			auto it = method_names.find(method);
+			if (it == method_names.end())
+				it = method_names.emplace(method, get_method_full_name(jvmti, method, false)).first;
+			return it->second;
+		}
+
+		inline static std::mutex control_mutex{};
+		inline static std::mutex samples_mutex{};
+		inline static JavaVM* vm = nullptr;
+		inline static jvmtiEnv* jvmti = nullptr;
+		inline static uint32_t interval_ms = 10;
+		inline static jint max_depth = 64;
+		inline static bool runnable_only = false;
+		inline static bool thread_names = true;
+		inline static std::vector<jthread> threads{};
+		inline static bool running = false;
+		inline static std::atomic<bool> stop_requested{ false };
+#ifdef _WIN32
+		inline static HANDLE thread = nullptr;
+#elif __linux__
+		inline static pthread_t thread{};
+#endif
+		inline static std::unordered_map<std::string, uint64_t> samples{}; // thread name, '\0', leaf first jmethodIDs -> count
+		inline static std::unordered_map<jmethodID, std::string> method_names{};
+		inline static uint64_t sample_count = 0;
+		inline static uint64_t stack_count = 0;
+		inline static uint64_t sampling_ns = 0;
+	};
+
+	class class_index // every loaded class by name, whatever its class loader, kept current with ClassPrepare events
+	{
+	public:
+		static bool start() // jni::get_cached_jclass looks classes up here before trying FindClass and the custom find class
+		{
+			JNIEnv* env = get_env();
+			if (!env) return false;
+			std::lock_guard control_lock{ control_mutex };
+			if (jvmti) return false;
+			jvmti = create_env();
+			if (!jvmti) return false;
+			jvmtiEventCallbacks callbacks{};
+			callbacks.ClassPrepare = class_prepare;
+			if (jvmti->SetEventCallbacks(&callbacks, (jint)sizeof(callbacks)) != JVMTI_ERROR_NONE)
+			{
+				jvmti->DisposeEnvironment();
+				jvmti = nullptr;
+				return false;
+			}
+			{
+				std::unique_lock unique_lock{ mutex };
+				indexing = true;
+			}
+			jvmti->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_CLASS_PREPARE, nullptr); // before listing, so no class falls in between
+
+			jint klass_count = 0;
+			jclass* klasses = nullptr;
+			if (jvmti->GetLoadedClasses(&klass_count, &klasses) == JVMTI_ERROR_NONE)
+			{
+				for (jint i = 0; i < klass_count; ++i)
+				{
+					add(jvmti, env, klasses[i]);
+					env->DeleteLocalRef(klasses[i]);
+				}
+				jvmti->Deallocate((unsigned char*)klasses);
+			}
+			_indexed_find_class.store(find_local, std::memory_order_release);
+			return true;
+		}
+
+		static void stop()
+		{
+			std::lock_guard control_lock{ control_mutex };
+			if (!jvmti) return;
+			_indexed_find_class.store(nullptr, std::memory_order_release);
+			jvmti->SetEventNotificationMode(JVMTI_DISABLE, JVMTI_EVENT_CLASS_PREPARE, nullptr);
+			{
+				std::unique_lock unique_lock{ mutex };
+				indexing = false; // a ClassPrepare event already dispatched adds nothing after this
+				for (auto& [name, klass_object] : klasses)
+					delete_weak_global_ref(klass_object); // stop may be called from a thread without a JNIEnv
+				klasses.clear();
+			}
+			jvmti->DisposeEnvironment();
+			jvmti = nullptr;
+		}
+
+		static jclass find(const char* class_name) // internal name like FindClass ("net/minecraft/Foo"), local ref, null if not loaded
+		{
+			return find_local(get_env(), class_name);
+		}
+
+		static size_t size()
+		{
+			std::shared_lock shared_lock{ mutex };
+			return klasses.size();
+		}
+	private:
+		struct name_hash
+		{
+			using is_transparent = void;
+			size_t operator()(std::string_view name) const
+			{
+				return std::hash<std::string_view>{}(name);
+			}
+		};
+
+		static jclass find_local(JNIEnv* env, const char* class_name)
+		{
+			if (!env || !class_name) return nullptr;
+			std::shared_lock shared_lock{ mutex };
+			auto it = klasses.find(std::string_view(class_name));
+			if (it == klasses.end()) return nullptr;
+			return (jclass)env->NewLocalRef(it->second); // null once the class was unloaded
+		}
+
+		static void add(jvmtiEnv* jvmti_env, JNIEnv* env, jclass klass_object)
+		{
+			char* signature = nullptr;
+			if (jvmti_env->GetClassSignature(klass_object, &signature, nullptr) != JVMTI_ERROR_NONE) return;
+			std::string name = take_string(jvmti_env, signature);
+			if (name.size() >= 2 && name.front() == 'L' && name.back() == ';') // arrays keep their descriptor, like FindClass
+				name = name.substr(1, name.size() - 2);
+			std::unique_lock unique_lock{ mutex };
+			if (!indexing) return;
+			auto [it, inserted] = klasses.try_emplace(std::move(name), nullptr);
+			if (!inserted)
+			{
+				if (!env->IsSameObject(it->second, nullptr)) return; // several loaders define this name, the first one is kept while it's loaded
+				env->DeleteWeakGlobalRef(it->second);
+			}
+			it->second = (jweak)env->NewWeakGlobalRef(klass_object); // weak, indexing a class mustn't prevent its loader from being unloaded
+		}
+
+		static void JNICALL class_prepare(jvmtiEnv* jvmti_env, JNIEnv* jni_env, jthread, jclass klass_object)
+		{
+			add(jvmti_env, jni_env, klass_object);
+		}
+
+		inline static std::mutex control_mutex{};
+		inline static std::shared_mutex mutex{};
+		inline static jvmtiEnv* jvmti = nullptr;
+		inline static bool indexing = false; // under mutex, between start and stop
+		inline static std::unordered_map<std::string, jweak, name_hash, std::equal_to<>> klasses{};
+	};
+
+	struct instance_scan_options
+	{
+		bool include_subclasses = true; // false lets the JVM filter the heap walk by the exact class
+		bool with_sizes = false; // shallow size of every instance, reported by the heap walk itself
+		jint batch_size = 256; // instances per batch, each batch lives in its own local frame
+	};
+
+	class _heap_scanner // a jvmtiEnv per scan, its tags only mean something during the scan and scans can nest (on_batch may scan again)
+	{
+	public:
+		using batch_callback = std::function<void(jobject* objects, jint count, const jlong* sizes)>;
+
+		static size_t scan(jclass target, const instance_scan_options& options, const batch_callback& on_batch)
+		{
+			JNIEnv* env = get_env();
+			if (!env || !target || options.batch_size <= 0) return 0;
+			jvmtiEnv* jvmti = create();
+			if (!jvmti) return 0;
+
+			if (options.include_subclasses)
+				mark_subclasses(jvmti, env, target);
+
+			// single heap pass: instances are tagged with their size (or a single tag), so one GetObjectsWithTags fetches them all,
+			// it walks every tag of the env for each call and compares it with every requested tag: O(instances * distinct sizes) instead of a call per batch
+			scan_context context{ options.with_sizes };
+			jvmtiHeapCallbacks callbacks{};
+			callbacks.heap_iteration_callback = tag_instance;
+			jvmti->IterateThroughHeap(options.include_subclasses ? JVMTI_HEAP_FILTER_CLASS_UNTAGGED : 0, options.include_subclasses ? nullptr : target, &callbacks, &context);
+
+			size_t delivered = 0;
+			if (context.instances && env->PushLocalFrame((jint)(std::min)(context.instances + 16, (size_t)INT32_MAX)) == 0)
+			{
+				jint count = 0;
+				jobject* objects = nullptr;
+				jlong* found_tags = nullptr;
+				if (jvmti->GetObjectsWithTags((jint)context.tags.size(), context.tags.data(), &count, &objects, options.with_sizes ? &found_tags : nullptr) == JVMTI_ERROR_NONE)
+				{
+					std::vector<jlong> sizes{};
+					for (jint first = 0; first < count; first += options.batch_size)
+					{
+						jint batch_count = (std::min)(options.batch_size, count - first);
+						sizes.clear();
+						for (jint i = first; options.with_sizes && i < first + batch_count; ++i)
+							sizes.push_back(found_tags[i] - size_tag_base);
+						if (env->PushLocalFrame(16) != 0) break; // the refs on_batch creates are freed with its batch
+						on_batch(objects + first, batch_count, options.with_sizes ? sizes.data() : nullptr); // instances collected since the heap pass are missing
+						env->PopLocalFrame(nullptr);
+						for (jint i = first; i < first + batch_count; ++i)
+							env->DeleteLocalRef(objects[i]);
+						delivered += batch_count;
+					}
+					jvmti->Deallocate((unsigned char*)objects);
+					if (found_tags) jvmti->Deallocate((unsigned char*)found_tags);
+				}
+				env->PopLocalFrame(nullptr);
+			}
+			jvmti->DisposeEnvironment(); // drops the tags of the classes and instances at once
+			return delivered;
+		}
+	private:
+		static constexpr jlong klass_tag = 1; // classes whose instances are collected
+		static constexpr jlong instance_tag = 2; // without sizes
+		static constexpr jlong size_tag_base = 2; // with sizes, tag = size_tag_base + shallow size
+
+		struct scan_context
+		{
+			bool with_sizes;
+			size_t instances = 0;
+			std::vector<jlong> tags{}; // distinct
+		};
+
+		static jvmtiEnv* create()
+		{
+			jvmtiEnv* jvmti = create_env();
+			if (!jvmti) return nullptr;
+			jvmtiCapabilities capabilities{};
+			capabilities.can_tag_objects = 1;
+			if (jvmti->AddCapabilities(&capabilities) == JVMTI_ERROR_NONE) return jvmti;
+			jvmti->DisposeEnvironment();
+			return nullptr;
+		}
+
+		static void mark_subclasses(jvmtiEnv* jvmti, JNIEnv* env, jclass target)
+		{
+			jint klass_count = 0;
+			jclass* klasses = nullptr;
+			if (jvmti->GetLoadedClasses(&klass_count, &klasses) != JVMTI_ERROR_NONE) return;
+			for (jint i = 0; i < klass_count; ++i)
+			{
+				if (env->IsAssignableFrom(klasses[i], target))
+					jvmti->SetTag(klasses[i], klass_tag); // the tag keeps no ref, the class can't be unloaded while it has instances
+				env->DeleteLocalRef(klasses[i]);
+			}
+			jvmti->Deallocate((unsigned char*)klasses);
+		}
+
+		// called with the VM stopped, no JNI here
+		static jint JNICALL tag_instance(jlong /*class_tag*/, jlong size, jlong* tag_ptr, jint /*length*/, void* user_data)
+		{
+			scan_context& context = *(scan_context*)user_data;
+			*tag_ptr = context.with_sizes ? size_tag_base + size : instance_tag;
+			if (std::find(context.tags.begin(), context.tags.end(), *tag_ptr) == context.tags.end())
+				context.tags.push_back(*tag_ptr);
+			++context.instances;
+			return 0;
+		}
+	};
+
+	// calls on_batch(std::vector<klass_type>& instances, const jlong* sizes) for every live instance of klass_type, batch by batch
+	// instances are local refs freed after each batch, copy them to klass_type::global to keep them, sizes is null unless options.with_sizes
+	template<class klass_type, class batch_function> requires std::invocable<batch_function, std::vector<typename klass_type::local>&, const jlong*>
+	inline size_t instances_of(batch_function&& on_batch, const instance_scan_options& options = {})
+	{
+		using local_type = typename klass_type::local;
+		std::vector<local_type> instances{};
+		return _heap_scanner::scan(get_cached_jclass<local_type>(), options, [&](jobject* objects, jint count, const jlong* sizes)
+		{
+			instances.clear();
+			for (jint i = 0; i < count; ++i)
+				instances.emplace_back(objects[i]);
+			on_batch(instances, sizes);
+		});
+	}
+
+	template<class klass_type>
+	inline std::vector<typename klass_type::global> instances_of(const instance_scan_options& options = {}) // every live instance as a global ref
+	{
+		std::vector<typename klass_type::global> result{};
+		instances_of<klass_type>([&](std::vector<typename klass_type::local>& instances, const jlong*)
+		{
+			for (typename klass_type::local& instance : instances)
+				result.emplace_back(instance);
+		}, options);
+		return result;
+	}
+
+#ifdef METAJNI_GC_STATS
+	class gc_monitor // feeds jni::gc with the stop-the-world pauses reported by JVMTI
+	{
+	public:
+		static bool start()
+		{
+			std::lock_guard lock{ mutex };
+			if (jvmti) return false;
+			jvmti = create_env();
+			if (!jvmti) return false;
+			jvmtiCapabilities capabilities{};
+			capabilities.can_generate_garbage_collection_events = 1;
+			jvmtiEventCallbacks callbacks{};
+			callbacks.GarbageCollectionStart = garbage_collection_start;
+			callbacks.GarbageCollectionFinish = garbage_collection_finish;
+			if (jvmti->AddCapabilities(&capabilities) != JVMTI_ERROR_NONE
+				|| jvmti->SetEventCallbacks(&callbacks, (jint)sizeof(callbacks)) != JVMTI_ERROR_NONE)
+			{
+				jvmti->DisposeEnvironment();
+				jvmti = nullptr;
+				return false;
+			}
+			jvmti->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_GARBAGE_COLLECTION_START, nullptr);
+			jvmti->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_GARBAGE_COLLECTION_FINISH, nullptr);
+			return true;
+		}
+
+		static void stop()
+		{
+			std::lock_guard lock{ mutex };
+			if (!jvmti) return;
+			jvmti->SetEventNotificationMode(JVMTI_DISABLE, JVMTI_EVENT_GARBAGE_COLLECTION_START, nullptr);
+			jvmti->SetEventNotificationMode(JVMTI_DISABLE, JVMTI_EVENT_GARBAGE_COLLECTION_FINISH, nullptr);
+			jvmti->DisposeEnvironment();
+			jvmti = nullptr;
+			if (jni::gc::_epoch.load(std::memory_order_relaxed) & 1)
+				jni::gc::_pause_finished(); // stopped during a pause, keep the epoch even
+		}
+	private:
+		// called while the VM is stopped, JNI and most of JVMTI are forbidden here
+		static void JNICALL garbage_collection_start(jvmtiEnv*)
+		{
+			jni::gc::_pause_started();
+		}
+
+		static void JNICALL garbage_collection_finish(jvmtiEnv*)
+		{
+			if (jni::gc::_epoch.load(std::memory_order_relaxed) & 1) // started before we attached otherwise
+				jni::gc::_pause_finished();
+		}
+
+		inline static std::mutex mutex{};
+		inline static jvmtiEnv* jvmti = nullptr;
+	};
+#endif
+}
+
+namespace jni
+{
+	// maps java objects to C++ state by identity in O(1): the object's JVMTI tag is the index of its slot
+	// every map has its own jvmtiEnv, so its own tag space; entries of collected objects are removed by purge() / the next insertion
+	template<class value_type>
+	class identity_map
+	{
+	public:
+		identity_map()
+		{
+			create();
+		}
+
+		~identity_map()
+		{
+			dispose();
+		}
+
+		identity_map(const identity_map&) = delete;
+		identity_map& operator=(const identity_map&) = delete;
+
+		bool valid() const // false if JVMTI or its tagging capabilities are unavailable
+		{
+			return jvmti;
+		}
+
+		value_type* find(jobject object_instance) // stays valid until the entry is erased, or purged after its object is collected
+		{
+			std::shared_lock shared_lock{ mutex };
+			jlong tag = get_tag(object_instance);
+			return tag ? &*slots[tag - 1] : nullptr;
+		}
+
+		template<class factory_type>
+		value_type& get_or_insert(jobject object_instance, factory_type&& factory) // factory is only called when the object has no entry
+		{
+			{
+				std::shared_lock shared_lock{ mutex };
+				if (jlong tag = get_tag(object_instance)) return *slots[tag - 1];
+			}
+			std::unique_lock unique_lock{ mutex };
+			apply_freed();
+			if (jlong tag = get_tag(object_instance)) return *slots[tag - 1]; // inserted by another thread meanwhile
+			size_t index = allocate_slot();
+			slots[index].emplace(factory());
+			jvmti->SetTag(object_instance, (jlong)index + 1);
+			++count;
+			return *slots[index];
+		}
+
+		value_type& insert_or_assign(jobject object_instance, value_type value)
+		{
+			bool inserted = false;
+			value_type& entry = get_or_insert(object_instance, [&] { inserted = true; return std::move(value); });
+			if (!inserted) entry = std::move(value);
+			return entry;
+		}
+
+		bool erase(jobject object_instance)
+		{
+			std::unique_lock unique_lock{ mutex };
+			jlong tag = get_tag(object_instance);
+			if (!tag) return false;
+			jvmti->SetTag(object_instance, 0);
+			release_slot((size_t)tag - 1);
+			return true;
+		}
+
+		size_t purge() // removes the entries of collected objects, returns how many were removed
+		{
+			std::unique_lock unique_lock{ mutex };
+			return apply_freed();
+		}
+
+		size_t size() const // includes collected objects not purged yet
+		{
+			std::shared_lock shared_lock{ mutex };
+			return count;
+		}
+
+		template<class function_type>
+		void for_each(function_type&& function) // function(value_type&), the objects themselves aren't reachable from their tags
+		{
+			std::shared_lock shared_lock{ mutex };
+			for (std::optional<value_type>& slot : slots)
+				if (slot) function(*slot);
+		}
+
+		void clear() // a new jvmtiEnv drops every tag at once
+		{
+			std::unique_lock unique_lock{ mutex };
+			dispose();
+			create();
+		}
+	private:
+		struct freed_tag // pushed by ObjectFree, which can't take locks or call JNI, allocated with jvmtiEnv::Allocate (allowed there, unlike new)
+		{
+			jlong tag;
+			freed_tag* next;
+		};
+
+		void create()
+		{
+			jvmti = jni::jvmti::create_env();
+			if (!jvmti) return;
+			jvmtiCapabilities capabilities{};
+			capabilities.can_tag_objects = 1;
+			capabilities.can_generate_object_free_events = 1;
+			jvmtiEventCallbacks callbacks{};
+			callbacks.ObjectFree = object_free;
+			if (jvmti->AddCapabilities(&capabilities) != JVMTI_ERROR_NONE
+				|| jvmti->SetEnvironmentLocalStorage(this) != JVMTI_ERROR_NONE
+				|| jvmti->SetEventCallbacks(&callbacks, (jint)sizeof(callbacks)) != JVMTI_ERROR_NONE
+				|| jvmti->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_OBJECT_FREE, nullptr) != JVMTI_ERROR_NONE)
+			{
+				jvmti->DisposeEnvironment();
+				jvmti = nullptr;
+			}
+		}
+
+		void dispose()
+		{
+			if (jvmti)
+			{
+				jvmti->SetEventNotificationMode(JVMTI_DISABLE, JVMTI_EVENT_OBJECT_FREE, nullptr);
+				for (freed_tag* node = freed.exchange(nullptr, std::memory_order_acquire); node;)
+				{
+					freed_tag* next = node->next;
+					jvmti->Deallocate((unsigned char*)node);
+					node = next;
+				}
+				jvmti->DisposeEnvironment();
+				jvmti = nullptr;
+			}
+			slots.clear();
+			free_slots.clear();
+			count = 0;
+		}
+
+		jlong get_tag(jobject object_instance) const
+		{
+			jlong tag = 0;
+			if (!jvmti || !object_instance || jvmti->GetTag(object_instance, &tag) != JVMTI_ERROR_NONE) return 0;
+			return tag;
+		}
+
+		size_t allocate_slot()
+		{
+			if (free_slots.empty())
+			{
+				slots.emplace_back();
+				return slots.size() - 1;
+			}
+			size_t index = free_slots.back();
+			free_slots.pop_back();
+			return index;
+		}
+
+		void release_slot(size_t index)
+		{
+			slots[index].reset();
+			free_slots.push_back(index);
+			--count;
+		}
+
+		size_t apply_freed() // with the unique lock held
+		{
+			size_t removed = 0;
+			for (freed_tag* node = freed.exchange(nullptr, std::memory_order_acquire); node; ++removed)
+			{
+				release_slot((size_t)node->tag - 1);
+				freed_tag* next = node->next;
+				jvmti->Deallocate((unsigned char*)node);
+				node = next;
+			}
+			return removed;
+		}
+
+		static void JNICALL object_free(jvmtiEnv* jvmti_env, jlong tag)
+		{
+			identity_map* map = nullptr;
+			if (jvmti_env->GetEnvironmentLocalStorage((void**)&map) != JVMTI_ERROR_NONE || !map) return;
+			freed_tag* node = nullptr;
+			if (jvmti_env->Allocate(sizeof(freed_tag), (unsigned char**)&node) != JVMTI_ERROR_NONE) return; // out of native memory, the entry stays until erase or clear
+			*node = { tag, map->freed.load(std::memory_order_relaxed) };
+			while (!map->freed.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		mutable std::shared_mutex mutex{};
+		jvmtiEnv* jvmti = nullptr;
+		std::deque<std::optional<value_type>> slots{}; // index = tag - 1, a deque so values never move
+		std::vector<size_t> free_slots{};
+		size_t count = 0;
+		std::atomic<freed_tag*> freed{ nullptr };
+	};
+}
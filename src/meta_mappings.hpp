@@ -0,0 +1,508 @@
+#pragma once
+
+#include "meta_jni.hpp"
+#include <string_view>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <algorithm>
+#include <cctype>
+
+#ifdef _WIN32
+	#include <Windows.h>
+#elif defined(__linux__)
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+// write the mappings with readable names (BEGIN_KLASS_DEF(Minecraft, "net/minecraft/client/Minecraft"), jni::field<jint, "displayWidth">)
+// and load the obfuscated names of the running version at startup with jni::load_mappings("client.txt")
+// supported formats: ProGuard (Mojang mappings), SRG (MCP), Tiny v1 / v2 (Fabric, first namespace obfuscated)
+namespace jni
+{
+	class mapping_file : public name_mapper
+	{
+	public:
+		mapping_file() = default;
+		mapping_file(const mapping_file&) = delete;
+		mapping_file& operator=(const mapping_file&) = delete;
+
+		~mapping_file()
+		{
+			unmap();
+		}
+
+		bool load(const char* path) // memory maps the file and indexes it
+		{
+			if (!map(path)) return false;
+			std::string_view text{ data, size };
+			if (text.starts_with("v1\t")) parse_tiny(text, 1);
+			else if (text.starts_with("tiny\t2\t")) parse_tiny(text, 2);
+			else if (text.starts_with("PK: ") || text.starts_with("CL: ") || text.starts_with("FD: ") || text.starts_with("MD: ")) parse_srg(text);
+			else parse_proguard(text);
+			finish();
+			return !classes.entries.empty();
+		}
+
+		std::string_view obfuscated_class(std::string_view readable_name) const // empty if not mapped
+		{
+			return classes.find(readable_name);
+		}
+
+		std::string_view readable_class(std::string_view obfuscated_name) const
+		{
+			return readable_classes.find(obfuscated_name);
+		}
+
+		std::string_view obfuscated_field(std::string_view readable_class_name, std::string_view readable_name) const
+		{
+			return fields.find(readable_class_name, readable_name);
+		}
+
+		std::string_view obfuscated_method(std::string_view readable_class_name, std::string_view readable_name, std::string_view obfuscated_descriptor) const
+		{
+			return methods.find(readable_class_name, readable_name, obfuscated_descriptor);
+		}
+
+		size_t class_count() const
+		{
+			return classes.entries.size();
+		}
+
+		size_t member_count() const
+		{
+			return fields.entries.size() + methods.entries.size();
+		}
+
+		std::string class_name(const char* class_name) const override
+		{
+			if (class_name[0] == '[') return descriptor(class_name);
+			std::string_view mapped = obfuscated_class(class_name);
+			return std::string(mapped.empty() ? std::string_view(class_name) : mapped);
+		}
+
+		std::string descriptor(const char* descriptor) const override
+		{
+			return map_descriptor(descriptor, classes);
+		}
+
+		std::string member_name(jclass owner_klass, const char* name, const char* mapped_descriptor, bool is_method) const override // looks in the owner, then its superclasses
+		{
+			if (!get_env() || !owner_klass) return name;
+			for (const std::string& readable : *readable_hierarchy(owner_klass))
+			{
+				std::string_view mapped = is_method ? obfuscated_method(readable, name, mapped_descriptor) : obfuscated_field(readable, name);
+				if (!mapped.empty()) return std::string(mapped);
+			}
+			return name;
+		}
+	private:
+		struct table // open addressing with linear probing, keys of up to 3 parts hashed with FNV-1a, the first key added wins
+		{
+			struct entry
+			{
+				uint64_t hash;
+				std::string_view key[3];
+				std::string_view value;
+			};
+
+			static uint64_t hash_of(std::string_view a, std::string_view b, std::string_view c)
+			{
+				uint64_t hash = 14695981039346656037ull;
+				for (std::string_view part : { a, b, c })
+				{
+					for (char ch : part)
+						hash = (hash ^ (uint8_t)ch) * 1099511628211ull;
+					hash = (hash ^ 0xff) * 1099511628211ull; // separator, ("ab", "c") != ("a", "bc")
+				}
+				return hash;
+			}
+
+			void add(std::string_view value, std::string_view a, std::string_view b = {}, std::string_view c = {})
+			{
+				entries.push_back({ hash_of(a, b, c), { a, b, c }, value });
+			}
+
+			void build()
+			{
+				size_t capacity = 16;
+				while (capacity < entries.size() * 2) capacity *= 2;
+				slots.assign(capacity, 0);
+				for (uint32_t i = 0; i < entries.size(); ++i)
+				{
+					const entry& e = entries[i];
+					for (size_t slot = e.hash & (capacity - 1);; slot = (slot + 1) & (capacity - 1))
+					{
+						if (!slots[slot])
+						{
+							slots[slot] = i + 1;
+							break;
+						}
+						const entry& other = entries[slots[slot] - 1];
+						if (other.hash == e.hash && other.key[0] == e.key[0] && other.key[1] == e.key[1] && other.key[2] == e.key[2]) break;
+					}
+				}
+			}
+
+			std::string_view find(std::string_view a, std::string_view b = {}, std::string_view c = {}) const
+			{
+				if (slots.empty()) return {};
+				uint64_t hash = hash_of(a, b, c);
+				for (size_t slot = hash & (slots.size() - 1); slots[slot]; slot = (slot + 1) & (slots.size() - 1))
+				{
+					const entry& e = entries[slots[slot] - 1];
+					if (e.hash == hash && e.key[0] == a && e.key[1] == b && e.key[2] == c) return e.value;
+				}
+				return {};
+			}
+
+			std::vector<entry> entries{};
+			std::vector<uint32_t> slots{}; // entry index + 1, 0 when empty
+		};
+
+		struct pending_member // until every class is known, so owners and descriptors can be translated
+		{
+			std::string_view owner;
+			bool owner_is_obfuscated;
+			std::string_view readable_name;
+			std::string_view obfuscated_name;
+			std::string_view descriptor; // empty for fields
+			bool descriptor_is_obfuscated;
+		};
+
+		std::shared_ptr<const std::vector<std::string>> readable_hierarchy(jclass owner_klass) const // readable names of the owner and its superclasses, walked once per class
+		{
+			uint32_t epoch = _class_epoch.load(std::memory_order_acquire);
+			{
+				std::lock_guard lock{ hierarchies_mutex };
+				if (hierarchies_epoch != epoch) // the classes may have been replaced, their refs released
+				{
+					hierarchies.clear();
+					hierarchies_epoch = epoch;
+				}
+				auto it = hierarchies.find(owner_klass);
+				if (it != hierarchies.end()) return it->second;
+			}
+			auto hierarchy = std::make_shared<std::vector<std::string>>();
+			JNIEnv* env = get_env();
+			frame lookup_frame{ 8 };
+			jclass klass_object = owner_klass;
+			for (int depth = 0; klass_object && depth < 64; ++depth)
+			{
+				std::string runtime_name = get_class_name(klass_object);
+				std::replace(runtime_name.begin(), runtime_name.end(), '.', '/');
+				std::string_view readable = readable_class(runtime_name);
+				hierarchy->push_back(readable.empty() ? std::move(runtime_name) : std::string(readable)); // not obfuscated, eg java/lang/Object
+				jclass super_klass = _track_local_ref(env->GetSuperclass(klass_object));
+				if (klass_object != owner_klass) delete_local_ref(klass_object);
+				klass_object = super_klass;
+			}
+			if (_is_current_class(owner_klass)) // cached classes only, their refs live until the next epoch
+			{
+				std::lock_guard lock{ hierarchies_mutex };
+				if (hierarchies_epoch == epoch) hierarchies.try_emplace(owner_klass, hierarchy);
+			}
+			return hierarchy;
+		}
+
+		bool map(const char* path)
+		{
+#ifdef _WIN32
+			HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE) return false;
+			LARGE_INTEGER file_size{};
+			GetFileSizeEx(file, &file_size);
+			HANDLE mapping = file_size.QuadPart ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+			CloseHandle(file);
+			if (!mapping) return false;
+			data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+			size = (size_t)file_size.QuadPart;
+#elif __linux__
+			int file = open(path, O_RDONLY);
+			if (file < 0) return false;
+			struct stat file_stat{};
+			if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0)
+			{
+				close(file);
+				return false;
+			}
+			void* mapped = mmap(nullptr, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+			close(file);
+			if (mapped == MAP_FAILED) return false;
+			data = (const char*)mapped;
+			size = (size_t)file_stat.st_size;
+#endif
+			return data;
+		}
+
+		void unmap()
+		{
+			if (!data) return;
+#ifdef _WIN32
+			UnmapViewOfFile(data);
+#elif __linux__
+			munmap((void*)data, size);
+#endif
+			data = nullptr;
+		}
+
+		std::string_view store(std::string value) // for names that don't exist as is in the file
+		{
+			return strings.emplace_back(std::move(value));
+		}
+
+		static std::string_view trim(std::string_view str)
+		{
+			while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) str.remove_prefix(1);
+			while (!str.empty() && (str.back() == ' ' || str.back() == '\t' || str.back() == '\r')) str.remove_suffix(1);
+			return str;
+		}
+
+		template<class function_type>
+		static void for_each_line(std::string_view text, function_type&& function)
+		{
+			while (!text.empty())
+			{
+				size_t end = text.find('\n');
+				std::string_view line = text.substr(0, end);
+				if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+				function(line);
+				if (end == std::string_view::npos) break;
+				text.remove_prefix(end + 1);
+			}
+		}
+
+		static std::vector<std::string_view> split(std::string_view line, char separator)
+		{
+			std::vector<std::string_view> parts{};
+			for (size_t start = 0;;)
+			{
+				size_t end = line.find(separator, start);
+				parts.push_back(line.substr(start, end - start));
+				if (end == std::string_view::npos) return parts;
+				start = end + 1;
+			}
+		}
+
+		std::string_view slashed(std::string_view dotted_name) // "net.minecraft.Foo" -> "net/minecraft/Foo"
+		{
+			if (dotted_name.find('.') == std::string_view::npos) return dotted_name;
+			std::string name{ dotted_name };
+			std::replace(name.begin(), name.end(), '.', '/');
+			return store(std::move(name));
+		}
+
+		static std::string java_type_descriptor(std::string_view type) // "int[]" -> "[I", "net.minecraft.Foo" -> "Lnet/minecraft/Foo;"
+		{
+			std::string prefix{};
+			while (type.ends_with("[]"))
+			{
+				prefix += '[';
+				type.remove_suffix(2);
+			}
+			static constexpr std::pair<std::string_view, char> primitives[] = { { "void", 'V' }, { "boolean", 'Z' }, { "byte", 'B' }, { "char", 'C' }, { "short", 'S' }, { "int", 'I' }, { "float", 'F' }, { "long", 'J' }, { "double", 'D' } };
+			for (auto [name, code] : primitives)
+				if (type == name) return prefix + code;
+			std::string name{ type };
+			std::replace(name.begin(), name.end(), '.', '/');
+			return prefix + 'L' + name + ';';
+		}
+
+		void parse_proguard(std::string_view text)
+		{
+			std::string_view current_class{};
+			for_each_line(text, [&](std::string_view line)
+			{
+				if (line.empty() || trim(line).starts_with('#')) return;
+				size_t arrow = line.find(" -> ");
+				if (arrow == std::string_view::npos) return;
+				if (line.front() != ' ' && line.front() != '\t') // "net.minecraft.client.Minecraft -> ave:"
+				{
+					std::string_view obfuscated = trim(line.substr(arrow + 4));
+					if (obfuscated.ends_with(':')) obfuscated.remove_suffix(1);
+					current_class = slashed(trim(line.substr(0, arrow)));
+					classes.add(slashed(obfuscated), current_class);
+					return;
+				}
+				if (current_class.empty()) return;
+				std::string_view obfuscated = trim(line.substr(arrow + 4));
+				std::string_view member = trim(line.substr(0, arrow));
+				while (!member.empty() && (std::isdigit((unsigned char)member.front()) || member.front() == ':')) member.remove_prefix(1); // "12:14:" line numbers
+				size_t space = member.find(' ');
+				if (space == std::string_view::npos) return;
+				std::string_view type = member.substr(0, space);
+				std::string_view name = member.substr(space + 1);
+				size_t open = name.find('(');
+				if (open == std::string_view::npos) // "int displayWidth -> d"
+				{
+					members.push_back({ current_class, false, name, obfuscated, {}, false });
+					return;
+				}
+				size_t close = name.find(')', open); // "void resize(int,int):16:18 -> a"
+				if (close == std::string_view::npos) return;
+				std::string descriptor = "(";
+				std::string_view parameters = name.substr(open + 1, close - open - 1);
+				if (!parameters.empty())
+					for (std::string_view parameter : split(parameters, ','))
+						descriptor += java_type_descriptor(trim(parameter));
+				descriptor += ')' + java_type_descriptor(type);
+				members.push_back({ current_class, false, name.substr(0, open), obfuscated, store(std::move(descriptor)), false });
+			});
+		}
+
+		void parse_srg(std::string_view text)
+		{
+			for_each_line(text, [&](std::string_view line)
+			{
+				std::vector<std::string_view> parts = split(trim(line), ' ');
+				auto owner_and_name = [](std::string_view path) // "a/b/c" -> "a/b", "c"
+				{
+					size_t slash = path.rfind('/');
+					if (slash == std::string_view::npos) return std::pair<std::string_view, std::string_view>{ {}, path };
+					return std::pair{ path.substr(0, slash), path.substr(slash + 1) };
+				};
+				if (parts[0] == "CL:" && parts.size() >= 3) // "CL: ave net/minecraft/client/Minecraft"
+					classes.add(parts[1], parts[2]);
+				else if (parts[0] == "FD:" && parts.size() >= 3) // "FD: ave/d net/minecraft/client/Minecraft/displayWidth", descriptors optional
+				{
+					auto [obfuscated_owner, obfuscated_name] = owner_and_name(parts[1]);
+					auto [readable_owner, readable_name] = owner_and_name(parts[parts.size() == 5 ? 3 : 2]);
+					members.push_back({ readable_owner, false, readable_name, obfuscated_name, {}, false });
+				}
+				else if (parts[0] == "MD:" && parts.size() >= 5) // "MD: ave/a (II)V net/minecraft/client/Minecraft/resize (II)V"
+				{
+					auto [obfuscated_owner, obfuscated_name] = owner_and_name(parts[1]);
+					auto [readable_owner, readable_name] = owner_and_name(parts[3]);
+					members.push_back({ readable_owner, false, readable_name, obfuscated_name, parts[2], true });
+				}
+			});
+		}
+
+		void parse_tiny(std::string_view text, int version) // the first namespace is the obfuscated one, the readable one is "named" or the last
+		{
+			size_t readable_column = 0;
+			std::string_view current_class{};
+			bool header = true;
+			for_each_line(text, [&](std::string_view line)
+			{
+				std::vector<std::string_view> parts = split(line, '\t');
+				if (header)
+				{
+					header = false;
+					size_t first_namespace = version == 1 ? 1 : 3; // "v1\tofficial\tnamed", "tiny\t2\t0\tofficial\tnamed"
+					readable_column = parts.size() > first_namespace ? parts.size() - 1 - first_namespace : 0;
+					for (size_t i = first_namespace; i < parts.size(); ++i)
+						if (parts[i] == "named") readable_column = i - first_namespace;
+					return;
+				}
+				auto column = [&](size_t first, size_t namespace_index) // tiny leaves a name empty when it's the same as the previous namespace
+				{
+					for (size_t i = first + namespace_index + 1; i-- > first;)
+						if (i < parts.size() && !parts[i].empty()) return parts[i];
+					return std::string_view{};
+				};
+				if (version == 1)
+				{
+					if (parts[0] == "CLASS" && parts.size() >= 3)
+						classes.add(parts[1], column(1, readable_column));
+					else if ((parts[0] == "FIELD" || parts[0] == "METHOD") && parts.size() >= 5) // "METHOD\tave\t(II)V\ta\tresize"
+						members.push_back({ parts[1], true, column(3, readable_column), parts[3], parts[0] == "METHOD" ? parts[2] : std::string_view{}, true });
+					return;
+				}
+				if (parts[0] == "c" && parts.size() >= 3) // "c\tave\tnet/minecraft/client/Minecraft"
+				{
+					current_class = parts[1];
+					classes.add(parts[1], column(1, readable_column));
+				}
+				else if (parts.size() >= 5 && parts[0].empty() && (parts[1] == "f" || parts[1] == "m") && !current_class.empty()) // "\tm\t(II)V\ta\tresize"
+					members.push_back({ current_class, true, column(3, readable_column), parts[3], parts[1] == "m" ? parts[2] : std::string_view{}, true });
+			});
+		}
+
+		static std::string map_descriptor(std::string_view descriptor, const table& class_table) // translates every "L...;" of a descriptor
+		{
+			std::string result{};
+			result.reserve(descriptor.size());
+			for (size_t i = 0; i < descriptor.size(); ++i)
+			{
+				if (descriptor[i] != 'L')
+				{
+					result += descriptor[i];
+					continue;
+				}
+				size_t end = descriptor.find(';', i);
+				if (end == std::string_view::npos) return std::string(descriptor);
+				std::string_view name = descriptor.substr(i + 1, end - i - 1);
+				std::string_view mapped = class_table.find(name);
+				result += 'L';
+				result += mapped.empty() ? name : mapped;
+				result += ';';
+				i = end;
+			}
+			return result;
+		}
+
+		void finish() // builds the indexes, members are keyed by readable owner and name, and obfuscated descriptor (what GetMethodID gets)
+		{
+			// parsers add classes as (obfuscated value, readable key), empty names come from incomplete rows
+			std::vector<table::entry> parsed = std::move(classes.entries);
+			classes.entries.clear();
+			for (const table::entry& e : parsed)
+			{
+				if (e.value.empty() || e.key[0].empty()) continue;
+				classes.entries.push_back(e);
+				readable_classes.add(e.key[0], e.value);
+			}
+			classes.build();
+			readable_classes.build();
+			for (const pending_member& member : members)
+			{
+				std::string_view owner = member.owner;
+				if (member.owner_is_obfuscated)
+				{
+					owner = readable_classes.find(owner);
+					if (owner.empty()) owner = member.owner;
+				}
+				if (member.descriptor.empty())
+					fields.add(member.obfuscated_name, owner, member.readable_name);
+				else
+				{
+					std::string_view descriptor = member.descriptor_is_obfuscated ? member.descriptor : store(map_descriptor(member.descriptor, classes));
+					methods.add(member.obfuscated_name, owner, member.readable_name, descriptor);
+				}
+			}
+			members.clear();
+			members.shrink_to_fit();
+			fields.build();
+			methods.build();
+		}
+
+		const char* data = nullptr;
+		size_t size = 0;
+		std::deque<std::string> strings{}; // a deque so the views stay valid
+		std::vector<pending_member> members{};
+		table classes{}; // readable -> obfuscated
+		table readable_classes{}; // obfuscated -> readable
+		table fields{};
+		table methods{};
+		mutable std::mutex hierarchies_mutex{};
+		mutable std::unordered_map<jclass, std::shared_ptr<const std::vector<std::string>>> hierarchies{}; // of the classes cached at hierarchies_epoch
+		mutable uint32_t hierarchies_epoch = 0;
+	};
+
+	inline bool load_mappings(const char* path) // call before resolving klasses, the cached ones are invalidated
+	{
+		auto loaded = std::make_shared<mapping_file>();
+		if (!loaded->load(path)) return false;
+		_set_name_mapper(std::move(loaded)); // the replaced file is unmapped once no resolution uses it
+		invalidate_all_classes();
+		return true;
+	}
+}
@@ -0,0 +1,93 @@
+// C++20 named module of MetaJNI, built by the MetaJNI::metajni_module target (cmake -DMETAJNI_MODULE=ON, CMake 3.28+)
+// import metajni; then #include "meta_jni_macros.hpp" for BEGIN_KLASS_DEF and co, modules don't export macros
+// the instrumentation layers (METAJNI_CALL_STATS...) and meta_jvmti.hpp / meta_mappings.hpp still need the header
+module;
+
+#include "meta_jni.hpp"
+
+export module metajni;
+
+export
+{
+	using ::JNIEnv;
+	using ::JavaVM;
+	using ::jobject;
+	using ::jclass;
+	using ::jstring;
+	using ::jarray;
+	using ::jobjectArray;
+	using ::jthrowable;
+	using ::jweak;
+	using ::jboolean;
+	using ::jbyte;
+	using ::jchar;
+	using ::jshort;
+	using ::jint;
+	using ::jfloat;
+	using ::jlong;
+	using ::jdouble;
+	using ::jsize;
+	using ::jvalue;
+	using ::jfieldID;
+	using ::jmethodID;
+}
+
+export namespace jni
+{
+	// environment and lifetime
+	using jni::get_env;
+	using jni::set_thread_env;
+	using jni::init;
+	using jni::shutdown;
+	using jni::set_custom_find_class;
+	using jni::drain_deferred_refs;
+	using jni::delete_global_ref;
+	using jni::delete_weak_global_ref;
+	using jni::delete_local_ref;
+	using jni::deferred_ref_stats;
+	using jni::get_deferred_ref_stats;
+	using jni::get_class_name;
+	using jni::_track_local_ref; // used by mappings creating objects, eg String::create
+
+	// classes
+	using jni::get_cached_jclass;
+	using jni::class_loader;
+	using jni::class_loader_scope;
+	using jni::invalidate_class;
+	using jni::invalidate_all_classes;
+	using jni::name_mapper;
+
+	// frames
+	using jni::frame;
+	using jni::frame_site;
+	using jni::scoped_frame;
+
+	// mappings
+	using jni::string_litteral;
+	using jni::is_static_t;
+	using jni::STATIC;
+	using jni::NOT_STATIC;
+	using jni::empty_members;
+	using jni::object_wrapper;
+	using jni::object_parameter;
+	using jni::parameter_t;
+	using jni::is_jni_primitive_type;
+	using jni::get_signature_for_type;
+	using jni::precomputed_signature;
+	using jni::klass;
+	using jni::field;
+	using jni::method;
+	using jni::constructor;
+	using jni::basic_array;
+	using jni::array;
+	using jni::string_arena;
+	using jni::member_site;
+	using jni::get_member_site;
+
+	// ownership
+	using jni::local_ref;
+	using jni::global_ref;
+	using jni::shared_global;
+	using jni::weak;
+	using jni::weak_cache;
+}
@@ -0,0 +1,165 @@
+#pragma once
+// timing and reporting shared by MetaJNI_bench (mock JNIEnv) and MetaJNI_e2e (embedded JVM)
+// usage of both: [--batches N] [--batch-size N] [--json path]
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct bench_options
+{
+	uint32_t batches = 200;
+	uint32_t batch_size = 1000; // operations timed together, a single JNI call is too short for the clock
+	std::string json_path{};
+
+	uint64_t operations() const // of a measure(), with the warm up batch
+	{
+		return (uint64_t)(batches + 1) * batch_size;
+	}
+};
+
+inline bool parse_bench_options(int argc, char** argv, bench_options& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string_view arg = argv[i];
+		if (i + 1 < argc && arg == "--batches") options.batches = (uint32_t)std::max(1, std::atoi(argv[++i]));
+		else if (i + 1 < argc && arg == "--batch-size") options.batch_size = (uint32_t)std::max(1, std::atoi(argv[++i]));
+		else if (i + 1 < argc && arg == "--json") options.json_path = argv[++i];
+		else
+		{
+			std::cerr << "usage: " << argv[0] << " [--batches N] [--batch-size N] [--json path]\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+struct bench_stats
+{
+	double p50_ns = 0.0; // per operation, percentiles of the batch averages
+	double p99_ns = 0.0;
+	double ops_per_second = 0.0;
+	double jni_calls_per_op = -1.0; // only known with the mock JNIEnv
+};
+
+template<class T> inline void keep(const T& value) // the result must be computed
+{
+	volatile T sink = value;
+	(void)sink;
+}
+
+struct no_op
+{
+	void operator()() const
+	{
+	}
+};
+
+template<class operation_type, class between_batches_type = no_op>
+bench_stats measure(const bench_options& options, operation_type&& operation, between_batches_type between_batches = {}) // between_batches isn't timed, eg. to pop the local refs of a batch
+{
+	for (uint32_t i = 0; i < options.batch_size; ++i) // warm up, resolves classes and member ids
+		operation();
+	between_batches();
+	std::vector<double> samples{};
+	samples.reserve(options.batches);
+	std::chrono::nanoseconds total{};
+	for (uint32_t batch = 0; batch < options.batches; ++batch)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < options.batch_size; ++i)
+			operation();
+		auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+		total += elapsed;
+		samples.push_back((double)elapsed.count() / options.batch_size);
+		between_batches();
+	}
+	std::sort(samples.begin(), samples.end());
+	bench_stats stats{};
+	stats.p50_ns = samples[samples.size() / 2];
+	stats.p99_ns = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+	stats.ops_per_second = total.count() ? (double)options.batches * options.batch_size * 1e9 / (double)total.count() : 0.0;
+	return stats;
+}
+
+class bench_report // one row per operation, MetaJNI next to the same operation written with raw JNI
+{
+public:
+	struct row
+	{
+		std::string name;
+		bench_stats wrapper;
+		bench_stats raw;
+	};
+
+	explicit bench_report(std::string benchmark) :
+		benchmark(std::move(benchmark))
+	{
+	}
+
+	void add(std::string name, const bench_stats& wrapper, const bench_stats& raw)
+	{
+		rows.push_back({ std::move(name), wrapper, raw });
+	}
+
+	void print(std::ostream& out) const
+	{
+		out << std::left << std::setw(24) << "operation" << std::setw(12) << "p50 ns" << std::setw(12) << "p99 ns" << std::setw(14) << "Mops/s"
+			<< std::setw(12) << "raw p50" << std::setw(12) << "raw p99" << std::setw(14) << "raw Mops/s" << std::setw(10) << "overhead" << "JNI calls/op (raw)\n";
+		for (const row& r : rows)
+		{
+			out << std::setw(24) << r.name << std::fixed << std::setprecision(1)
+				<< std::setw(12) << r.wrapper.p50_ns << std::setw(12) << r.wrapper.p99_ns << std::setw(14) << std::setprecision(2) << r.wrapper.ops_per_second / 1e6
+				<< std::setprecision(1) << std::setw(12) << r.raw.p50_ns << std::setw(12) << r.raw.p99_ns << std::setw(14) << std::setprecision(2) << r.raw.ops_per_second / 1e6
+				<< std::setw(10) << (r.raw.p50_ns > 0 ? r.wrapper.p50_ns / r.raw.p50_ns : 0.0);
+			if (r.wrapper.jni_calls_per_op >= 0)
+				out << r.wrapper.jni_calls_per_op << " (" << r.raw.jni_calls_per_op << ")";
+			out << '\n';
+		}
+	}
+
+	bool write_json(const std::string& path, const bench_options& options) const
+	{
+		std::ofstream out{ path };
+		if (!out) return false;
+		out << "{\n\t\"benchmark\": \"" << benchmark << "\",\n\t\"batches\": " << options.batches << ",\n\t\"batch_size\": " << options.batch_size << ",\n\t\"results\": [";
+		for (size_t i = 0; i < rows.size(); ++i)
+		{
+			out << (i ? "," : "") << "\n\t\t{ \"name\": \"" << rows[i].name << "\", ";
+			write_stats(out, "metajni", rows[i].wrapper);
+			out << ", ";
+			write_stats(out, "raw", rows[i].raw);
+			out << " }";
+		}
+		out << "\n\t]\n}\n";
+		return (bool)out;
+	}
+
+	int finish(const bench_options& options) const // prints the table, writes the json if asked, returns the exit code
+	{
+		print(std::cout);
+		if (options.json_path.empty()) return 0;
+		if (write_json(options.json_path, options)) return 0;
+		std::cerr << "can't write " << options.json_path << '\n';
+		return 1;
+	}
+private:
+	static void write_stats(std::ostream& out, const char* name, const bench_stats& stats)
+	{
+		out << '"' << name << "\": { \"p50_ns\": " << stats.p50_ns << ", \"p99_ns\": " << stats.p99_ns << ", \"ops_per_second\": " << stats.ops_per_second;
+		if (stats.jni_calls_per_op >= 0)
+			out << ", \"jni_calls_per_op\": " << stats.jni_calls_per_op;
+		out << " }";
+	}
+
+	std::string benchmark;
+	std::vector<row> rows{};
+};
@@ -0,0 +1,210 @@
+// Compile time benchmark of large mappings: generates synthetic mappings of N members, compiles them and reports time, peak memory, object and .text size
+// usage: metajni_compile_bench compiler source_dir work_dir [-DNAME...] [members...] (the metajni_compile_bench_report target runs 1000 5000 20000)
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+	#include <Windows.h>
+	#include <Psapi.h>
+#elif defined(__linux__)
+	#include <sys/resource.h>
+	#include <sys/wait.h>
+	#include <unistd.h>
+#endif
+
+struct compile_result
+{
+	bool ok = false;
+	double seconds = 0.0;
+	uint64_t peak_memory = 0; // bytes
+	uint64_t object_size = 0;
+	uint64_t text_size = 0; // code sections of the object
+};
+
+static constexpr const char* field_types[] = { "jboolean", "jbyte", "jchar", "jshort", "jint", "jfloat", "jlong", "jdouble", "Node", "jni::array<jint>" };
+static constexpr const char* field_values[] = { "JNI_TRUE", "jbyte(1)", "jchar(1)", "jshort(1)", "1", "1.f", "1LL", "1.0", "nullptr", "nullptr" };
+static constexpr int members_per_klass = 50;
+
+static void write_mappings(const std::filesystem::path& path, int members) // members cycle through every field type, static or not, and methods of 0 to 3 parameters
+{
+	std::ofstream out{ path };
+	out << "#pragma once\n#include \"meta_jni.hpp\"\n\nnamespace bench\n{\n\tBEGIN_KLASS_DEF(Node, \"bench/Node\")\n\tEND_KLASS_DEF()\n";
+	std::ofstream use{ std::filesystem::path(path).replace_extension(".cpp") };
+	use << "#include \"" << path.filename().string() << "\"\n\nnamespace bench\n{\n";
+	int types = (int)std::size(field_types);
+	for (int klass = 0; klass * members_per_klass < members; ++klass)
+	{
+		out << "\n\tBEGIN_KLASS_DEF(K" << klass << ", \"bench/K" << klass << "\")\n";
+		use << "\tvoid use_" << klass << "(K" << klass << "& k)\n\t{\n";
+		for (int i = klass * members_per_klass; i < members && i < (klass + 1) * members_per_klass; ++i)
+		{
+			int type = i % types;
+			const char* is_static = (i / types) % 2 ? "jni::STATIC" : "jni::NOT_STATIC";
+			if ((i / (types * 2)) % 2 == 0)
+			{
+				out << "\t\tjni::field<" << field_types[type] << ", \"f" << i << "\", " << is_static << "> f" << i << "{ *this };\n";
+				use << "\t\tk.f" << i << " = " << field_values[type] << ";\n\t\t(void)k.f" << i << ".get();\n";
+				continue;
+			}
+			int parameters = i % 4;
+			out << "\t\tjni::method<" << (type == types - 1 ? "void" : field_types[type]) << ", \"m" << i << "\", " << is_static;
+			for (int p = 0; p < parameters; ++p)
+				out << ", " << field_types[(type + p + 1) % types];
+			out << "> m" << i << "{ *this };\n";
+			use << "\t\t(void)k.m" << i << "(";
+			for (int p = 0; p < parameters; ++p)
+				use << (p ? ", " : "") << field_values[(type + p + 1) % types];
+			use << ");\n";
+		}
+		out << "\tEND_KLASS_DEF()\n";
+		use << "\t}\n";
+	}
+	out << "}\n";
+	use << "}\n";
+}
+
+template<class T> static T read_at(const std::vector<char>& bytes, size_t offset)
+{
+	T value{};
+	if (offset + sizeof(T) <= bytes.size()) std::memcpy(&value, bytes.data() + offset, sizeof(T));
+	return value;
+}
+
+static bool is_text_section(std::string_view name) // .text, and the .text.<function> (ELF) / .text$mn (COFF) sections of inline functions and templates
+{
+	return name == ".text" || name.starts_with(".text.") || name.starts_with(".text$");
+}
+
+static uint64_t get_text_size(const std::filesystem::path& object) // sums the code sections of an ELF64 or COFF (and /bigobj) object
+{
+	std::ifstream in{ object, std::ios::binary };
+	std::vector<char> bytes{ std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+	uint64_t size = 0;
+	if (bytes.size() >= 64 && std::memcmp(bytes.data(), "\x7f" "ELF", 4) == 0 && bytes[4] == 2)
+	{
+		uint64_t section_headers = read_at<uint64_t>(bytes, 0x28);
+		uint64_t section_count = read_at<uint16_t>(bytes, 0x3C);
+		uint64_t names_index = read_at<uint16_t>(bytes, 0x3E);
+		if (section_count == 0) section_count = read_at<uint64_t>(bytes, section_headers + 32); // more than 0xff00 sections, the count is in the first section header
+		if (names_index == 0xFFFF) names_index = read_at<uint32_t>(bytes, section_headers + 40);
+		uint64_t names = read_at<uint64_t>(bytes, section_headers + names_index * 64 + 24);
+		for (uint64_t i = 0; i < section_count; ++i)
+		{
+			uint64_t header = section_headers + i * 64;
+			uint64_t name = names + read_at<uint32_t>(bytes, header);
+			if (name < bytes.size() && is_text_section(bytes.data() + name))
+				size += read_at<uint64_t>(bytes, header + 32);
+		}
+		return size;
+	}
+	bool bigobj = read_at<uint16_t>(bytes, 0) == 0 && read_at<uint16_t>(bytes, 2) == 0xFFFF;
+	uint64_t section_count = bigobj ? read_at<uint32_t>(bytes, 44) : read_at<uint16_t>(bytes, 2);
+	uint64_t section_headers = bigobj ? 56 : 20 + read_at<uint16_t>(bytes, 16);
+	for (uint64_t i = 0; i < section_count && section_headers + (i + 1) * 40 <= bytes.size(); ++i)
+	{
+		uint64_t header = section_headers + i * 40;
+		std::string_view name(bytes.data() + header, strnlen(bytes.data() + header, 8));
+		if (is_text_section(name))
+			size += read_at<uint32_t>(bytes, header + 16);
+	}
+	return size;
+}
+
+static compile_result compile(const std::vector<std::string>& command, const std::filesystem::path& object)
+{
+	compile_result result{};
+	std::filesystem::remove(object);
+	auto start = std::chrono::steady_clock::now();
+#ifdef _WIN32
+	std::string command_line{};
+	for (const std::string& arg : command)
+		command_line += '"' + arg + "\" ";
+	STARTUPINFOA startup{ sizeof(STARTUPINFOA) };
+	PROCESS_INFORMATION process{};
+	if (!CreateProcessA(nullptr, command_line.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup, &process)) return result;
+	WaitForSingleObject(process.hProcess, INFINITE);
+	DWORD exit_code = 1;
+	GetExitCodeProcess(process.hProcess, &exit_code);
+	PROCESS_MEMORY_COUNTERS memory{};
+	if (GetProcessMemoryInfo(process.hProcess, &memory, sizeof(memory))) result.peak_memory = memory.PeakWorkingSetSize;
+	CloseHandle(process.hThread);
+	CloseHandle(process.hProcess);
+	result.ok = exit_code == 0;
+#elif __linux__
+	std::vector<char*> argv{};
+	for (const std::string& arg : command)
+		argv.push_back((char*)arg.c_str());
+	argv.push_back(nullptr);
+	pid_t child = fork();
+	if (child < 0) return result;
+	if (child == 0)
+	{
+		execvp(argv[0], argv.data());
+		_exit(127);
+	}
+	int status = 0;
+	rusage usage{};
+	if (wait4(child, &status, 0, &usage) < 0) return result;
+	result.peak_memory = (uint64_t)usage.ru_maxrss * 1024; // KB on linux
+	result.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#endif
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::error_code error{};
+	result.object_size = std::filesystem::file_size(object, error);
+	if (!error) result.text_size = get_text_size(object);
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		std::cerr << "usage: " << argv[0] << " compiler source_dir work_dir [-DNAME...] [members...]\n";
+		return 1;
+	}
+	std::string compiler = argv[1];
+	std::filesystem::path source_dir = argv[2], work_dir = argv[3];
+	std::vector<int> sizes{};
+	std::vector<std::string> defines{}; // eg -DMETAJNI_VARARGS_CALLS, the metajni_size_report target compares both dispatches
+	for (int i = 4; i < argc; ++i)
+	{
+		if (std::string_view(argv[i]).starts_with("-D")) defines.push_back(argv[i] + 2);
+		else sizes.push_back(std::atoi(argv[i]));
+	}
+	if (sizes.empty()) sizes = { 1000, 5000, 20000 };
+	std::filesystem::create_directories(work_dir);
+	std::string compiler_name = std::filesystem::path(compiler).stem().string();
+	bool msvc = compiler_name == "cl" || compiler_name == "clang-cl";
+	std::vector<std::string> includes = { (source_dir / "src").string(), (source_dir / "include" / "jni").string(),
+		(source_dir / "include" / "jni" / (msvc ? "win32" : "linux")).string() };
+
+	std::cout << std::left << std::setw(10) << "members" << std::setw(12) << "seconds" << std::setw(14) << "peak MB" << std::setw(14) << "object KB" << ".text KB\n";
+	bool all_ok = true;
+	for (int members : sizes)
+	{
+		std::filesystem::path header = work_dir / ("bench_" + std::to_string(members) + ".hpp");
+		std::filesystem::path source = std::filesystem::path(header).replace_extension(".cpp");
+		std::filesystem::path object = std::filesystem::path(header).replace_extension(msvc ? ".obj" : ".o");
+		write_mappings(header, members);
+		std::vector<std::string> command = { compiler };
+		if (msvc) command.insert(command.end(), { "/nologo", "/std:c++20", "/O2", "/EHsc", "/c", source.string(), "/Fo" + object.string() });
+		else command.insert(command.end(), { "-std=c++20", "-O2", "-c", source.string(), "-o", object.string() });
+		for (const std::string& include : includes)
+			command.push_back((msvc ? "/I" : "-I") + include);
+		for (const std::string& define : defines)
+			command.push_back((msvc ? "/D" : "-D") + define);
+		compile_result result = compile(command, object);
+		all_ok &= result.ok;
+		std::cout << std::setw(10) << members << std::setw(12) << std::fixed << std::setprecision(2) << result.seconds
+			<< std::setw(14) << std::setprecision(1) << result.peak_memory / (1024.0 * 1024.0)
+			<< std::setw(14) << result.object_size / 1024.0 << result.text_size / 1024.0 << (result.ok ? "" : "  (failed)") << std::endl;
+	}
+	return all_ok ? 0 : 1;
+}
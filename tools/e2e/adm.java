@@ -0,0 +1,7 @@
+import java.util.ArrayList;
+import java.util.List;
+
+public class adm // World
+{
+	public List<wn> j = new ArrayList<>(); // playerEntities
+}
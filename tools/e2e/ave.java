@@ -0,0 +1,21 @@
+// Stand-ins for the minecraft 1.8.9 classes mapped by src/mappings.hpp (same obfuscated names), compiled into the jar MetaJNI_e2e loads
+public class ave
+{
+	public static ave S = new ave(); // Minecraft.theMinecraft
+	public int d = 854; // displayWidth
+	public int e = 480; // displayHeight
+	public bew h = new bew(); // thePlayer
+	public bdb f = new bdb(h); // theWorld
+	public int clicks = 0;
+
+	public void aw() // clickMouse
+	{
+		++clicks;
+	}
+
+	public void a(int width, int height) // resize
+	{
+		d = width;
+		e = height;
+	}
+}
@@ -0,0 +1,7 @@
+public class bdb extends adm // WorldClient
+{
+	public bdb(bew player)
+	{
+		j.add(player);
+	}
+}
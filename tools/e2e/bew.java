@@ -0,0 +1,14 @@
+public class bew extends wn // EntityPlayerSP
+{
+	public String lastMessage = null;
+
+	public void e(String message) // sendChatMessage
+	{
+		lastMessage = message;
+	}
+
+	public String w() // getClientBrand
+	{
+		return "vanilla";
+	}
+}
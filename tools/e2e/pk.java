@@ -0,0 +1,9 @@
+public class pk // Entity
+{
+	public String name = "Player";
+
+	public String e_() // getName
+	{
+		return name;
+	}
+}
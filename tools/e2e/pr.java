@@ -0,0 +1,9 @@
+public class pr extends pk // EntityLivingBase
+{
+	public float health = 20.0f;
+
+	public float bn() // getHealth
+	{
+		return health;
+	}
+}
@@ -0,0 +1,3 @@
+public class wn extends pr // EntityPlayer
+{
+}
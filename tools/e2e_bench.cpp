@@ -0,0 +1,189 @@
+// End to end checks and benchmark of src/mappings.hpp in a JVM started in process (JNI_CreateJavaVM)
+// the jar of tools/e2e is built with the target, its classes have the obfuscated names of the mappings (static singleton, inheritance, lists, arrays, strings)
+// each operation is checked once, then timed through MetaJNI and written with raw JNI: p50 / p99 ns per operation and ops/sec
+#include "mappings.hpp"
+#include "bench_harness.hpp"
+
+#ifndef METAJNI_E2E_JAR
+	#define METAJNI_E2E_JAR "metajni_e2e.jar" // set by CMake to the built jar
+#endif
+
+static int failures = 0;
+
+static void check(bool condition, const char* expression)
+{
+	if (condition) return;
+	std::cerr << "check failed: " << expression << '\n';
+	++failures;
+}
+#define E2E_CHECK(condition) check(condition, #condition)
+
+static std::string raw_to_string(JNIEnv* env, jstring str)
+{
+	if (!str) return std::string();
+	std::string result(env->GetStringUTFLength(str), '\0');
+	env->GetStringUTFRegion(str, 0, env->GetStringLength(str), result.data());
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	bench_options options{};
+	if (!parse_bench_options(argc, argv, options)) return 1;
+
+	std::string class_path = std::string("-Djava.class.path=") + METAJNI_E2E_JAR;
+	JavaVMOption vm_options[] = { { class_path.data(), nullptr } };
+	JavaVMInitArgs vm_args{};
+	vm_args.version = JNI_VERSION_1_8;
+	vm_args.nOptions = (jint)std::size(vm_options);
+	vm_args.options = vm_options;
+	vm_args.ignoreUnrecognized = JNI_FALSE;
+	JavaVM* vm = nullptr;
+	JNIEnv* env = nullptr;
+	if (JNI_CreateJavaVM(&vm, (void**)&env, &vm_args) != JNI_OK)
+	{
+		std::cerr << "JNI_CreateJavaVM failed\n";
+		return 1;
+	}
+	jni::init();
+	jni::set_thread_env(env);
+	env->PushLocalFrame(64);
+
+	// checks, through the mappings and against raw JNI
+	maps::Minecraft minecraft = maps::Minecraft{}.theMinecraft.get();
+	E2E_CHECK(minecraft);
+	E2E_CHECK(minecraft.displayWidth == 854);
+	minecraft.displayWidth = 1280;
+	jclass minecraft_class = env->FindClass("ave");
+	jfieldID display_width = env->GetFieldID(minecraft_class, "d", "I");
+	E2E_CHECK(env->GetIntField(minecraft.object_instance, display_width) == 1280);
+	minecraft.resize(800, 600);
+	E2E_CHECK(minecraft.displayWidth == 800);
+
+	maps::EntityPlayerSP player = minecraft.thePlayer.get();
+	E2E_CHECK(player);
+	E2E_CHECK(player.getHealth() == 20.0f); // declared by a superclass
+	E2E_CHECK(player.getName().to_string() == "Player");
+	E2E_CHECK(player.getClientBrand().to_string() == "vanilla");
+	player.sendChatMessage(maps::String::create("hello"));
+	jfieldID last_message = env->GetFieldID(env->FindClass("bew"), "lastMessage", "Ljava/lang/String;");
+	E2E_CHECK(raw_to_string(env, (jstring)env->GetObjectField(player.object_instance, last_message)) == "hello");
+
+	std::vector<maps::Object> players = minecraft.theWorld.get().playerEntities.get().toArray().to_vector();
+	E2E_CHECK(players.size() == 1 && env->IsSameObject(players[0].object_instance, player.object_instance));
+	E2E_CHECK((jni::array<jint>::create({ 1, 2, 3 }).to_vector() == std::vector<jint>{ 1, 2, 3 }));
+	E2E_CHECK((jni::array<maps::String>::from_strings(std::vector<std::string>{ "a", "bc" }).to_strings().to_vector() == std::vector<std::string>{ "a", "bc" }));
+	maps::URL url = maps::URL::new_object(&maps::URL::constructor, maps::String::create("http://www.example.com/docs/resource1.html"));
+	E2E_CHECK(url.toString().to_string() == "http://www.example.com/docs/resource1.html");
+	E2E_CHECK(!env->ExceptionCheck());
+	env->PopLocalFrame(nullptr);
+	if (failures)
+	{
+		std::cerr << failures << " checks failed\n";
+		return 1;
+	}
+
+	int exit_code = 1;
+	{ // the global wrappers are released before jni::shutdown
+		struct
+		{
+			jclass minecraft_class;
+			jfieldID the_minecraft;
+			jfieldID display_width;
+			jmethodID resize;
+			jmethodID get_health;
+			jmethodID get_client_brand;
+			jmethodID send_chat_message;
+			jclass url_class;
+			jmethodID url_constructor;
+		} raw{};
+		raw.minecraft_class = (jclass)env->NewGlobalRef(env->FindClass("ave"));
+		raw.the_minecraft = env->GetStaticFieldID(raw.minecraft_class, "S", "Lave;");
+		raw.display_width = env->GetFieldID(raw.minecraft_class, "d", "I");
+		raw.resize = env->GetMethodID(raw.minecraft_class, "a", "(II)V");
+		jclass player_class = env->FindClass("bew");
+		raw.get_health = env->GetMethodID(player_class, "bn", "()F");
+		raw.get_client_brand = env->GetMethodID(player_class, "w", "()Ljava/lang/String;");
+		raw.send_chat_message = env->GetMethodID(player_class, "e", "(Ljava/lang/String;)V");
+		raw.url_class = (jclass)env->NewGlobalRef(env->FindClass("java/net/URL"));
+		raw.url_constructor = env->GetMethodID(raw.url_class, "<init>", "(Ljava/lang/String;)V");
+
+		maps::Minecraft::global minecraft_global{ maps::Minecraft{}.theMinecraft.get() };
+		maps::EntityPlayerSP::global player_global{ minecraft_global.thePlayer.get() };
+		maps::String::global message{ maps::String::create("hello") };
+		maps::String::global url_string{ maps::String::create("http://www.example.com/") };
+		std::vector<jint> values(64, 1);
+		jni::array<jint>::global ints{ jni::array<jint>::create(values) };
+		jobject minecraft_object = minecraft_global.object_instance;
+		jobject player_object = player_global.object_instance;
+		jintArray int_array = (jintArray)ints.object_instance;
+
+		env->PushLocalFrame((jint)options.batch_size * 2 + 16);
+		auto pop_local_refs = [&] // the local refs of a batch die with its frame
+		{
+			env->PopLocalFrame(nullptr);
+			env->PushLocalFrame((jint)options.batch_size * 2 + 16);
+		};
+		bench_report report{ "MetaJNI_e2e" };
+		auto run = [&](const char* name, auto&& wrapper_operation, auto&& raw_operation)
+		{
+			bench_stats wrapper = measure(options, wrapper_operation, pop_local_refs);
+			bench_stats raw_stats = measure(options, raw_operation, pop_local_refs);
+			report.add(name, wrapper, raw_stats);
+		};
+
+		run("field_get",
+			[&] { keep(minecraft_global.displayWidth.get()); },
+			[&] { keep(env->GetIntField(minecraft_object, raw.display_width)); });
+		run("field_set",
+			[&] { minecraft_global.displayWidth = 854; },
+			[&] { env->SetIntField(minecraft_object, raw.display_width, 854); });
+		run("static_field_get_object",
+			[&] { keep(minecraft_global.theMinecraft.get().object_instance); },
+			[&] { keep(env->GetStaticObjectField(raw.minecraft_class, raw.the_minecraft)); });
+		run("method_call_void",
+			[&] { minecraft_global.resize(854, 480); },
+			[&] { env->CallVoidMethod(minecraft_object, raw.resize, 854, 480); });
+		run("method_call_inherited",
+			[&] { keep(player_global.getHealth()); },
+			[&] { keep(env->CallFloatMethod(player_object, raw.get_health)); });
+		run("method_call_object",
+			[&] { keep(player_global.getClientBrand().object_instance); },
+			[&] { keep(env->CallObjectMethod(player_object, raw.get_client_brand)); });
+		run("method_call_string_arg",
+			[&] { player_global.sendChatMessage(message); },
+			[&] { env->CallVoidMethod(player_object, raw.send_chat_message, message.object_instance); });
+		run("string_to_std",
+			[&] { keep(maps::String{ message.object_instance }.to_string().size()); },
+			[&] { keep(raw_to_string(env, (jstring)message.object_instance).size()); });
+		run("klass_construct",
+			[&] { maps::Minecraft constructed{ minecraft_object }; keep(constructed.object_instance); },
+			[&] { keep(minecraft_object); });
+		run("klass_copy",
+			[&] { maps::Minecraft::global copy{ minecraft_global }; keep(copy.object_instance); },
+			[&] { jobject copy = env->NewGlobalRef(minecraft_object); keep(copy); env->DeleteGlobalRef(copy); });
+		run("array_to_vector",
+			[&] { keep(ints.to_vector().size()); },
+			[&]
+			{
+				std::vector<jint> result(env->GetArrayLength(int_array));
+				env->GetIntArrayRegion(int_array, 0, (jsize)result.size(), result.data());
+				keep(result.size());
+			});
+		run("new_object",
+			[&] { keep(maps::URL::new_object(&maps::URL::constructor, url_string).object_instance); },
+			[&] { keep(env->NewObject(raw.url_class, raw.url_constructor, url_string.object_instance)); });
+		run("get_cached_jclass", // raw: a FindClass per lookup, what code without a class cache does
+			[&] { keep(jni::get_cached_jclass<maps::Minecraft>()); },
+			[&] { jclass found = env->FindClass("ave"); keep(found); env->DeleteLocalRef(found); });
+		env->PopLocalFrame(nullptr);
+		E2E_CHECK(!env->ExceptionCheck());
+
+		env->DeleteGlobalRef(raw.minecraft_class);
+		env->DeleteGlobalRef(raw.url_class);
+		exit_code = failures ? 1 : report.finish(options);
+	}
+	jni::shutdown();
+	vm->DestroyJavaVM();
+	return exit_code;
+}
@@ -0,0 +1,740 @@
+// Generates MetaJNI mappings (BEGIN_KLASS_DEF style headers) from compiled classes, doesn't need a JVM
+// usage: metajni-gen [-o mappings.hpp] [--namespace maps] [--package net/minecraft/] [--public] [--synthetic] [--signatures] inputs...
+// inputs are .class files, directories (searched recursively) and jars
+#include "classfile_constants.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct member_info
+{
+	uint16_t access = 0;
+	std::string name;
+	std::string descriptor;
+};
+
+struct class_info
+{
+	uint16_t access = 0;
+	std::string name; // internal name, "net/minecraft/Foo"
+	std::string super_name; // empty for java/lang/Object
+	std::vector<member_info> fields;
+	std::vector<member_info> methods;
+	std::string identifier; // C++ name of the klass
+	bool referenced_only = false; // used in a signature but not in the inputs, generated without members
+};
+
+struct options
+{
+	std::string output;
+	std::string namespace_name = "maps";
+	std::vector<std::string> packages;
+	bool public_only = false;
+	bool synthetic = false;
+	bool signatures = false;
+};
+
+class inflater // raw DEFLATE (RFC 1951), the only compression jars use besides stored entries
+{
+public:
+	static bool inflate(const uint8_t* in, size_t in_size, std::vector<uint8_t>& out)
+	{
+		inflater state{ in, in_size, out };
+		for (bool last = false; !last;)
+		{
+			last = state.bits(1);
+			uint32_t type = state.bits(2);
+			bool ok = type == 0 ? state.stored() : type == 1 ? state.fixed() : type == 2 ? state.dynamic() : false;
+			if (!ok || state.overflow) return false;
+		}
+		return true;
+	}
+private:
+	struct huffman // canonical code, symbols sorted by code length
+	{
+		uint16_t count[16];
+		uint16_t symbol[288];
+	};
+
+	inflater(const uint8_t* in, size_t in_size, std::vector<uint8_t>& out) :
+		in(in),
+		in_size(in_size),
+		out(out)
+	{
+	}
+
+	uint32_t bits(int n)
+	{
+		uint32_t value = bit_buffer;
+		while (bit_count < n)
+		{
+			if (position >= in_size)
+			{
+				overflow = true;
+				return 0;
+			}
+			value |= (uint32_t)in[position++] << bit_count;
+			bit_count += 8;
+		}
+		bit_buffer = value >> n;
+		bit_count -= n;
+		return value & ((1u << n) - 1);
+	}
+
+	bool stored()
+	{
+		bit_buffer = 0;
+		bit_count = 0;
+		if (position + 4 > in_size) return false;
+		uint32_t length = in[position] | (in[position + 1] << 8);
+		uint32_t complement = in[position + 2] | (in[position + 3] << 8);
+		position += 4;
+		if (length != (~complement & 0xffff) || position + length > in_size) return false;
+		out.insert(out.end(), in + position, in + position + length);
+		position += length;
+		return true;
+	}
+
+	static bool build(huffman& h, const uint16_t* lengths, int n)
+	{
+		std::fill(std::begin(h.count), std::end(h.count), 0);
+		for (int symbol = 0; symbol < n; ++symbol) ++h.count[lengths[symbol]];
+		int left = 1;
+		for (int length = 1; length < 16; ++length)
+		{
+			left = (left << 1) - h.count[length];
+			if (left < 0) return false; // over-subscribed
+		}
+		uint16_t offsets[16]{};
+		for (int length = 1; length < 15; ++length) offsets[length + 1] = offsets[length] + h.count[length];
+		for (int symbol = 0; symbol < n; ++symbol)
+			if (lengths[symbol]) h.symbol[offsets[lengths[symbol]]++] = (uint16_t)symbol;
+		return true;
+	}
+
+	int decode(const huffman& h)
+	{
+		int code = 0, first = 0, index = 0;
+		for (int length = 1; length < 16; ++length)
+		{
+			code |= (int)bits(1);
+			int count = h.count[length];
+			if (code - count < first) return h.symbol[index + (code - first)];
+			index += count;
+			first = (first + count) << 1;
+			code <<= 1;
+			if (overflow) return -1;
+		}
+		return -1;
+	}
+
+	bool codes(const huffman& lengths, const huffman& distances)
+	{
+		static constexpr uint16_t length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		static constexpr uint8_t length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		static constexpr uint16_t distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		static constexpr uint8_t distance_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+		for (;;)
+		{
+			int symbol = decode(lengths);
+			if (symbol < 0) return false;
+			if (symbol < 256)
+			{
+				out.push_back((uint8_t)symbol);
+				continue;
+			}
+			if (symbol == 256) return true;
+			symbol -= 257;
+			if (symbol >= 29) return false;
+			size_t length = length_base[symbol] + bits(length_extra[symbol]);
+			int distance_symbol = decode(distances);
+			if (distance_symbol < 0 || distance_symbol >= 30) return false;
+			size_t distance = distance_base[distance_symbol] + bits(distance_extra[distance_symbol]);
+			if (distance > out.size() || overflow) return false;
+			for (size_t i = 0; i < length; ++i) out.push_back(out[out.size() - distance]);
+		}
+	}
+
+	bool fixed()
+	{
+		static huffman lengths{}, distances{};
+		static bool built = [&]
+		{
+			uint16_t code_lengths[288 + 30]{};
+			std::fill(code_lengths, code_lengths + 144, 8);
+			std::fill(code_lengths + 144, code_lengths + 256, 9);
+			std::fill(code_lengths + 256, code_lengths + 280, 7);
+			std::fill(code_lengths + 280, code_lengths + 288, 8);
+			std::fill(code_lengths + 288, code_lengths + 318, 5);
+			return build(lengths, code_lengths, 288) && build(distances, code_lengths + 288, 30);
+		}();
+		return built && codes(lengths, distances);
+	}
+
+	bool dynamic()
+	{
+		static constexpr uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+		int length_count = (int)bits(5) + 257, distance_count = (int)bits(5) + 1, code_count = (int)bits(4) + 4;
+		if (length_count > 286 || distance_count > 30) return false;
+		uint16_t code_lengths[288 + 30]{};
+		for (int i = 0; i < code_count; ++i) code_lengths[order[i]] = (uint16_t)bits(3);
+		huffman lengths{}, distances{};
+		if (!build(lengths, code_lengths, 19)) return false;
+		std::fill(std::begin(code_lengths), std::end(code_lengths), 0);
+		for (int i = 0; i < length_count + distance_count;)
+		{
+			int symbol = decode(lengths);
+			if (symbol < 0) return false;
+			if (symbol < 16)
+			{
+				code_lengths[i++] = (uint16_t)symbol;
+				continue;
+			}
+			uint16_t repeated = 0;
+			int repeat = 0;
+			if (symbol == 16)
+			{
+				if (i == 0) return false;
+				repeated = code_lengths[i - 1];
+				repeat = 3 + (int)bits(2);
+			}
+			else repeat = symbol == 17 ? 3 + (int)bits(3) : 11 + (int)bits(7);
+			if (i + repeat > length_count + distance_count) return false;
+			while (repeat--) code_lengths[i++] = repeated;
+		}
+		if (!code_lengths[256]) return false; // no end of block code
+		return build(lengths, code_lengths, length_count) && build(distances, code_lengths + length_count, distance_count) && codes(lengths, distances);
+	}
+
+	const uint8_t* in;
+	size_t in_size;
+	size_t position = 0;
+	uint32_t bit_buffer = 0;
+	int bit_count = 0;
+	bool overflow = false;
+	std::vector<uint8_t>& out;
+};
+
+class class_reader // big endian, every read is bounds checked
+{
+public:
+	class_reader(const std::vector<uint8_t>& data) :
+		data(data)
+	{
+	}
+
+	uint32_t u(int size)
+	{
+		uint32_t value = 0;
+		for (int i = 0; i < size; ++i)
+		{
+			if (position >= data.size())
+			{
+				failed = true;
+				return 0;
+			}
+			value = (value << 8) | data[position++];
+		}
+		return value;
+	}
+
+	void skip(size_t size)
+	{
+		position += size;
+		if (position > data.size()) failed = true;
+	}
+
+	std::string_view bytes(size_t size)
+	{
+		if (position + size > data.size())
+		{
+			failed = true;
+			return {};
+		}
+		std::string_view view{ (const char*)data.data() + position, size };
+		position += size;
+		return view;
+	}
+
+	bool failed = false;
+private:
+	const std::vector<uint8_t>& data;
+	size_t position = 0;
+};
+
+static bool parse_class(const std::vector<uint8_t>& data, class_info& info)
+{
+	class_reader reader{ data };
+	if (reader.u(4) != 0xCAFEBABE) return false;
+	reader.skip(4); // minor, major version
+	uint32_t pool_count = reader.u(2);
+	std::vector<std::string_view> utf8(pool_count);
+	std::vector<uint16_t> class_names(pool_count); // JVM_CONSTANT_Class -> its Utf8 index
+	for (uint32_t i = 1; i < pool_count && !reader.failed; ++i)
+	{
+		switch (reader.u(1))
+		{
+		case JVM_CONSTANT_Utf8: utf8[i] = reader.bytes(reader.u(2)); break;
+		case JVM_CONSTANT_Class: class_names[i] = (uint16_t)reader.u(2); break;
+		case JVM_CONSTANT_String: case JVM_CONSTANT_MethodType: case JVM_CONSTANT_Module: case JVM_CONSTANT_Package: reader.skip(2); break;
+		case JVM_CONSTANT_MethodHandle: reader.skip(3); break;
+		case JVM_CONSTANT_Integer: case JVM_CONSTANT_Float: case JVM_CONSTANT_Fieldref: case JVM_CONSTANT_Methodref: case JVM_CONSTANT_InterfaceMethodref:
+		case JVM_CONSTANT_NameAndType: case JVM_CONSTANT_Dynamic: case JVM_CONSTANT_InvokeDynamic: reader.skip(4); break;
+		case JVM_CONSTANT_Long: case JVM_CONSTANT_Double: reader.skip(8); ++i; break; // takes two entries
+		default: return false;
+		}
+	}
+	auto string_at = [&](uint32_t index) { return std::string(index < pool_count ? utf8[index] : std::string_view{}); };
+	auto class_at = [&](uint32_t index) { return index < pool_count ? string_at(class_names[index]) : std::string(); };
+	info.access = (uint16_t)reader.u(2);
+	info.name = class_at(reader.u(2));
+	info.super_name = class_at(reader.u(2));
+	reader.skip(reader.u(2) * 2); // interfaces, jni::klass only maps the superclass
+	auto read_members = [&](std::vector<member_info>& members)
+	{
+		uint32_t count = reader.u(2);
+		for (uint32_t i = 0; i < count && !reader.failed; ++i)
+		{
+			member_info member{};
+			member.access = (uint16_t)reader.u(2);
+			member.name = string_at(reader.u(2));
+			member.descriptor = string_at(reader.u(2));
+			uint32_t attributes = reader.u(2);
+			for (uint32_t a = 0; a < attributes && !reader.failed; ++a)
+			{
+				reader.skip(2);
+				reader.skip(reader.u(4));
+			}
+			members.push_back(std::move(member));
+		}
+	};
+	read_members(info.fields);
+	read_members(info.methods);
+	return !reader.failed && !info.name.empty();
+}
+
+static bool read_file(const std::filesystem::path& path, std::vector<uint8_t>& data)
+{
+	std::ifstream in{ path, std::ios::binary };
+	if (!in) return false;
+	data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	return true;
+}
+
+template<class function_type>
+static bool for_each_jar_class(const std::vector<uint8_t>& jar, function_type&& function) // function(entry name, class bytes), zip64 isn't supported
+{
+	auto u16 = [&](size_t at) { return at + 2 <= jar.size() ? (uint32_t)(jar[at] | (jar[at + 1] << 8)) : 0u; };
+	auto u32 = [&](size_t at) { return u16(at) | (u16(at + 2) << 16); };
+	if (jar.size() < 22) return false;
+	size_t end = jar.size() - 22;
+	for (size_t limit = end > 0xffff ? end - 0xffff : 0; end > limit && u32(end) != 0x06054b50; --end);
+	if (u32(end) != 0x06054b50) return false;
+	uint32_t entries = u16(end + 10);
+	size_t entry = u32(end + 16);
+	for (uint32_t i = 0; i < entries; ++i)
+	{
+		if (u32(entry) != 0x02014b50) return false;
+		uint32_t method = u16(entry + 10), compressed_size = u32(entry + 20), size = u32(entry + 24);
+		uint32_t name_size = u16(entry + 28), extra_size = u16(entry + 30), comment_size = u16(entry + 32);
+		size_t local = u32(entry + 42);
+		if (entry + 46 + name_size > jar.size()) return false;
+		std::string name{ (const char*)jar.data() + entry + 46, name_size };
+		entry += 46 + name_size + extra_size + comment_size;
+		if (!name.ends_with(".class") || name.starts_with("META-INF/") || name.ends_with("module-info.class")) continue;
+		if (u32(local) != 0x04034b50) return false;
+		size_t data = local + 30 + u16(local + 26) + u16(local + 28);
+		if (data + compressed_size > jar.size()) return false;
+		std::vector<uint8_t> bytes{};
+		if (method == 0) bytes.assign(jar.begin() + data, jar.begin() + data + compressed_size);
+		else if (method == 8)
+		{
+			bytes.reserve(size);
+			if (!inflater::inflate(jar.data() + data, compressed_size, bytes) || bytes.size() != size)
+			{
+				std::cerr << name << ": corrupted entry\n";
+				continue;
+			}
+		}
+		else
+		{
+			std::cerr << name << ": unsupported compression " << method << '\n';
+			continue;
+		}
+		function(name, bytes);
+	}
+	return true;
+}
+
+static bool read_input(const std::filesystem::path& path, std::vector<class_info>& classes)
+{
+	auto add = [&](const std::string& source, const std::vector<uint8_t>& data)
+	{
+		class_info info{};
+		if (parse_class(data, info)) classes.push_back(std::move(info));
+		else std::cerr << source << ": not a valid class file\n";
+	};
+	std::error_code error{};
+	if (std::filesystem::is_directory(path, error))
+	{
+		for (const auto& file : std::filesystem::recursive_directory_iterator(path, error))
+		{
+			std::string extension = file.path().extension().string();
+			if (extension != ".class" && extension != ".jar") continue;
+			if (!read_input(file.path(), classes)) return false;
+		}
+		return true;
+	}
+	std::vector<uint8_t> data{};
+	if (!read_file(path, data))
+	{
+		std::cerr << path.string() << ": can't read\n";
+		return false;
+	}
+	if (path.extension() != ".jar")
+	{
+		add(path.string(), data);
+		return true;
+	}
+	if (!for_each_jar_class(data, [&](const std::string& name, const std::vector<uint8_t>& bytes) { add(path.string() + '!' + name, bytes); }))
+	{
+		std::cerr << path.string() << ": not a valid jar\n";
+		return false;
+	}
+	return true;
+}
+
+static bool is_reserved(std::string_view name) // C++ keywords and names jni::klass already uses
+{
+	static const std::set<std::string_view> reserved = {
+		"alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch", "char", "char8_t", "char16_t", "char32_t", "class",
+		"compl", "concept", "const", "consteval", "constexpr", "constinit", "const_cast", "continue", "co_await", "co_return", "co_yield", "decltype", "default",
+		"delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false", "float", "for", "friend", "goto", "if", "inline", "int",
+		"long", "mutable", "namespace", "new", "noexcept", "not", "not_eq", "nullptr", "operator", "or", "or_eq", "private", "protected", "public", "register",
+		"reinterpret_cast", "requires", "return", "short", "signed", "sizeof", "static", "static_assert", "static_cast", "struct", "switch", "template", "this",
+		"thread_local", "throw", "true", "try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while",
+		"xor", "xor_eq", "jni", "std", "assert", "errno", "NULL", "EOF",
+		"object_instance", "owner_klass", "is_same_object", "is_instance_of", "base_type", "local", "global", "weak", "get_name", "get_signature", "is_global", "new_object" };
+	return reserved.contains(name);
+}
+
+static std::string identifier(std::string_view name) // a valid C++ identifier close to a java name
+{
+	std::string result{};
+	for (char c : name)
+		result += std::isalnum((unsigned char)c) || c == '_' ? c : '_';
+	if (result.empty() || std::isdigit((unsigned char)result[0])) result.insert(0, "_");
+	if (is_reserved(result)) result += '_';
+	return result;
+}
+
+static std::string string_literal(std::string_view str) // modified UTF-8 bytes are kept, octal escapes can't swallow the next character
+{
+	std::string result = "\"";
+	for (unsigned char c : str)
+	{
+		if (c == '"' || c == '\\') (result += '\\') += (char)c;
+		else if (c >= 0x20 && c < 0x7f) result += (char)c;
+		else
+		{
+			char escaped[5];
+			std::snprintf(escaped, sizeof(escaped), "\\%03o", c);
+			result += escaped;
+		}
+	}
+	return result + '"';
+}
+
+class generator
+{
+public:
+	generator(std::vector<class_info>& parsed, const options& settings) :
+		settings(settings)
+	{
+		for (class_info& info : parsed)
+			if (accepted(info.name)) classes.emplace(info.name, std::move(info)); // the first class of a name wins
+		for (auto& [name, info] : classes)
+		{
+			std::erase_if(info.fields, [&](const member_info& m) { return !wanted(m, false); });
+			std::erase_if(info.methods, [&](const member_info& m) { return !wanted(m, true) || m.name == "<clinit>"; });
+		}
+		std::vector<std::string> referenced{};
+		for (auto& [name, info] : classes)
+		{
+			for (const member_info& field : info.fields) collect_classes(field.descriptor, referenced);
+			for (const member_info& method : info.methods) collect_classes(method.descriptor, referenced);
+		}
+		for (const std::string& name : referenced)
+			if (!classes.contains(name)) classes.emplace(name, class_info{ 0, name, {}, {}, {}, {}, true });
+		name_classes();
+	}
+
+	void write(std::ostream& out)
+	{
+		std::vector<const class_info*> ordered = superclasses_first();
+		const std::string& ns = settings.namespace_name;
+		out << "#pragma once\n// generated by metajni-gen, " << ordered.size() << " klasses\n\n#include \"meta_jni.hpp\"\n\nnamespace " << ns << "\n{\n";
+		for (const class_info* info : ordered)
+			out << "\tKLASS_DECLARATION(" << info->identifier << ", " << string_literal(info->name) << ");\n";
+		out << "}\n\n";
+		if (settings.signatures) write_signatures(out, ordered);
+		out << "namespace " << ns << "\n{\n";
+		for (const class_info* info : ordered)
+		{
+			const class_info* super_info = superclass(*info);
+			if (super_info) out << "\tBEGIN_KLASS_MEMBERS_EX(" << info->identifier << ", " << super_info->identifier << ")";
+			else out << "\tBEGIN_KLASS_MEMBERS(" << info->identifier << ")";
+			out << (info->referenced_only ? " // only referenced\n" : "\n");
+			for (const auto& [member_name, declaration] : members(*info))
+				out << "\t\t" << declaration << ' ' << member_name << "{ *this };\n";
+			out << "\tEND_KLASS_MEMBERS()\n";
+		}
+		out << "}\n";
+	}
+
+	size_t member_count() const
+	{
+		size_t count = 0;
+		for (const auto& [name, info] : classes) count += info.fields.size() + info.methods.size();
+		return count;
+	}
+
+	size_t class_count() const
+	{
+		return classes.size();
+	}
+private:
+	bool accepted(const std::string& name) const
+	{
+		if (settings.packages.empty()) return true;
+		for (const std::string& package : settings.packages)
+			if (name.starts_with(package)) return true;
+		return false;
+	}
+
+	bool wanted(const member_info& member, bool is_method) const
+	{
+		if (!settings.synthetic && (member.access & (is_method ? JVM_ACC_SYNTHETIC | JVM_ACC_BRIDGE : JVM_ACC_SYNTHETIC))) return false; // volatile fields share the bridge bit
+		if (settings.public_only && !(member.access & JVM_ACC_PUBLIC)) return false;
+		return true;
+	}
+
+	static void collect_classes(std::string_view descriptor, std::vector<std::string>& names)
+	{
+		for (size_t i = 0; i < descriptor.size(); ++i)
+		{
+			if (descriptor[i] != 'L') continue;
+			size_t end = descriptor.find(';', i);
+			if (end == std::string_view::npos) return;
+			names.emplace_back(descriptor.substr(i + 1, end - i - 1));
+			i = end;
+		}
+	}
+
+	void name_classes() // simple names when they're unique, else the full name
+	{
+		std::map<std::string, int> uses{};
+		for (auto& [name, info] : classes)
+		{
+			info.identifier = identifier(name.substr(name.rfind('/') + 1));
+			++uses[info.identifier];
+		}
+		std::set<std::string> taken{};
+		for (auto& [name, info] : classes)
+		{
+			if (uses[info.identifier] > 1 || info.identifier == settings.namespace_name) info.identifier = identifier(name);
+			while (!taken.insert(info.identifier).second) info.identifier += '_';
+		}
+	}
+
+	const class_info* superclass(const class_info& info) const
+	{
+		if (info.super_name.empty() || info.super_name == "java/lang/Object") return nullptr; // like the hand written mappings
+		auto found = classes.find(info.super_name);
+		return found == classes.end() ? nullptr : &found->second;
+	}
+
+	std::vector<const class_info*> superclasses_first() const // a klass' members derive from its superclass' members, which must be complete
+	{
+		std::vector<const class_info*> ordered{};
+		std::set<const class_info*> added{};
+		for (const auto& [name, info] : classes)
+		{
+			std::vector<const class_info*> chain{};
+			for (const class_info* current = &info; current && !added.contains(current); current = superclass(*current))
+			{
+				if (std::find(chain.begin(), chain.end(), current) != chain.end()) break; // malformed hierarchy
+				chain.push_back(current);
+			}
+			for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+				if (added.insert(*it).second) ordered.push_back(*it);
+		}
+		return ordered;
+	}
+
+	std::string type_of(std::string_view& descriptor) const // consumes one type of a descriptor
+	{
+		char code = descriptor.empty() ? 'V' : descriptor.front();
+		descriptor.remove_prefix(descriptor.empty() ? 0 : 1);
+		switch (code)
+		{
+		case 'Z': return "jboolean";
+		case 'B': return "jbyte";
+		case 'C': return "jchar";
+		case 'S': return "jshort";
+		case 'I': return "jint";
+		case 'F': return "jfloat";
+		case 'J': return "jlong";
+		case 'D': return "jdouble";
+		case 'V': return "void";
+		case '[': return "jni::array<" + type_of(descriptor) + ">";
+		case 'L':
+		{
+			size_t end = descriptor.find(';');
+			std::string name{ descriptor.substr(0, end) };
+			descriptor.remove_prefix(end == std::string_view::npos ? descriptor.size() : end + 1);
+			return settings.namespace_name + "::" + classes.at(name).identifier; // qualified, a member may have the name of a klass
+		}
+		}
+		return "void";
+	}
+
+	std::vector<std::pair<std::string, std::string>> members(const class_info& info) const // member name, jni::field / jni::method type
+	{
+		std::vector<std::pair<std::string, std::string>> result{};
+		std::set<std::string> taken{ settings.namespace_name }; // would hide the namespace of the klass types
+		auto add = [&](std::string name, std::string declaration)
+		{
+			while (!taken.insert(name).second) name += '_'; // overloads, fields and methods of the same name
+			result.emplace_back(std::move(name), std::move(declaration));
+		};
+		for (const member_info& field : info.fields)
+		{
+			std::string_view descriptor = field.descriptor;
+			std::string declaration = "jni::field<" + type_of(descriptor) + ", " + string_literal(field.name);
+			add(identifier(field.name), declaration + (field.access & JVM_ACC_STATIC ? ", jni::STATIC>" : ">"));
+		}
+		for (const member_info& method : info.methods)
+		{
+			std::string_view descriptor = method.descriptor;
+			std::vector<std::string> parameters{};
+			descriptor.remove_prefix(1);
+			while (!descriptor.empty() && descriptor.front() != ')') parameters.push_back(type_of(descriptor));
+			descriptor.remove_prefix(descriptor.empty() ? 0 : 1);
+			std::string return_type = type_of(descriptor);
+			std::string declaration{};
+			if (method.name == "<init>") declaration = "jni::constructor<";
+			else
+			{
+				declaration = "jni::method<" + return_type + ", " + string_literal(method.name);
+				if (method.access & JVM_ACC_STATIC) declaration += ", jni::STATIC";
+				else if (!parameters.empty()) declaration += ", jni::NOT_STATIC";
+			}
+			for (size_t i = 0; i < parameters.size(); ++i)
+				declaration += (i || method.name != "<init>" ? ", " : "") + parameters[i];
+			add(method.name == "<init>" ? "constructor" : identifier(method.name), declaration + ">");
+		}
+		return result;
+	}
+
+	void write_signatures(std::ostream& out, const std::vector<const class_info*>& ordered) const // one string per distinct signature, and jni::precomputed_signature for every member
+	{
+		std::map<std::string, size_t> strings{};
+		for (const class_info* info : ordered)
+		{
+			for (const member_info& field : info->fields) strings.emplace(field.descriptor, 0);
+			for (const member_info& method : info->methods) strings.emplace(method.descriptor, 0);
+		}
+		const std::string& ns = settings.namespace_name;
+		out << "namespace " << ns << "::signatures\n{\n";
+		size_t index = 0;
+		for (auto& [signature, id] : strings)
+		{
+			id = index++;
+			out << "\tinline constexpr jni::string_litteral s" << id << "{ " << string_literal(signature) << " };\n";
+		}
+		out << "}\n\n// right after the declarations, before any klass body uses a member: a specialization must precede the first use of its signature\nnamespace jni\n{\n";
+		std::set<std::string> specialized{}; // jni::field / jni::method types are shared by every klass declaring the same member
+		for (const class_info* info : ordered)
+		{
+			std::vector<std::pair<std::string, std::string>> declarations = members(*info);
+			size_t i = 0;
+			auto specialize = [&](const member_info& member)
+			{
+				const std::string& declaration = declarations[i++].second;
+				if (specialized.insert(declaration).second)
+					out << "\ttemplate<> inline constexpr auto precomputed_signature<" << declaration << "> = " << ns << "::signatures::s" << strings[member.descriptor] << ";\n";
+			};
+			for (const member_info& field : info->fields) specialize(field);
+			for (const member_info& method : info->methods) specialize(method);
+		}
+		out << "}\n\n";
+	}
+
+	const options& settings;
+	std::map<std::string, class_info> classes{}; // sorted by name so the output is stable
+};
+
+int main(int argc, char** argv)
+{
+	options settings{};
+	std::vector<std::string> inputs{};
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string_view arg = argv[i];
+		if ((arg == "-o" || arg == "--namespace" || arg == "--package") && i + 1 < argc)
+		{
+			std::string value = argv[++i];
+			if (arg == "-o") settings.output = value;
+			else if (arg == "--namespace") settings.namespace_name = value;
+			else settings.packages.push_back(value);
+		}
+		else if (arg == "--public") settings.public_only = true;
+		else if (arg == "--synthetic") settings.synthetic = true;
+		else if (arg == "--signatures") settings.signatures = true;
+		else if (arg.starts_with("-"))
+		{
+			inputs.clear();
+			break;
+		}
+		else inputs.emplace_back(arg);
+	}
+	if (inputs.empty())
+	{
+		std::cerr << "usage: " << argv[0] << " [-o mappings.hpp] [--namespace maps] [--package net/minecraft/] [--public] [--synthetic] [--signatures] classes.jar|directory|Foo.class...\n";
+		return 1;
+	}
+
+	std::vector<class_info> parsed{};
+	for (const std::string& input : inputs)
+		if (!read_input(input, parsed)) return 1;
+	if (parsed.empty())
+	{
+		std::cerr << "no class found\n";
+		return 1;
+	}
+
+	generator mappings{ parsed, settings };
+	if (settings.output.empty()) mappings.write(std::cout);
+	else
+	{
+		std::ofstream out{ settings.output };
+		mappings.write(out);
+		if (!out)
+		{
+			std::cerr << settings.output << ": can't write\n";
+			return 1;
+		}
+		std::cout << mappings.class_count() << " klasses, " << mappings.member_count() << " members\n";
+	}
+	return 0;
+}
@@ -0,0 +1,162 @@
+#pragma once
+// JNIEnv whose functions count their calls and return canned values, to run mappings without a JVM (MetaJNI_bench)
+// every function the library and the benchmarks use is mocked, the others abort when called
+#include <jni.h>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+class mock_jni_env
+{
+public:
+	struct canned_values // returned by every Get*Field / Call*Method of the type, and stored by Set*Field
+	{
+		jboolean z = JNI_TRUE;
+		jbyte b = 1;
+		jchar c = 1;
+		jshort s = 1;
+		jint i = 1;
+		jfloat f = 1.f;
+		jlong j = 1;
+		jdouble d = 1.0;
+		jobject l = fake_object;
+	};
+
+	static inline const jobject fake_object = (jobject)0x10;
+	static inline const jclass fake_class = (jclass)0x20;
+	static constexpr size_t slot_count = sizeof(JNINativeInterface_) / sizeof(void*);
+
+	JNIEnv_ env{}; // first member, the mocked functions get back to the mock_jni_env from their JNIEnv*
+	JNINativeInterface_ functions{};
+	canned_values values{};
+	jsize array_length = 64; // of every array
+	std::array<uint64_t, slot_count> calls{}; // per function, indexed by slot()
+
+	mock_jni_env()
+	{
+		void* unexpected = (void*)&unexpected_call;
+		for (size_t i = 0; i < slot_count; ++i)
+			std::memcpy((char*)&functions + i * sizeof(void*), &unexpected, sizeof(void*));
+		env.functions = &functions;
+
+		functions.GetVersion = [](JNIEnv* env) -> jint { record(env, &JNINativeInterface_::GetVersion); return JNI_VERSION_1_8; };
+		functions.FindClass = [](JNIEnv* env, const char*) -> jclass { record(env, &JNINativeInterface_::FindClass); return fake_class; };
+		functions.GetSuperclass = [](JNIEnv* env, jclass) -> jclass { record(env, &JNINativeInterface_::GetSuperclass); return nullptr; };
+		functions.GetObjectClass = [](JNIEnv* env, jobject) -> jclass { record(env, &JNINativeInterface_::GetObjectClass); return fake_class; };
+		functions.IsInstanceOf = [](JNIEnv* env, jobject, jclass) -> jboolean { record(env, &JNINativeInterface_::IsInstanceOf); return JNI_TRUE; };
+		functions.IsSameObject = [](JNIEnv* env, jobject a, jobject b) -> jboolean { record(env, &JNINativeInterface_::IsSameObject); return a == b; };
+		functions.ExceptionCheck = [](JNIEnv* env) -> jboolean { record(env, &JNINativeInterface_::ExceptionCheck); return JNI_FALSE; };
+		functions.ExceptionOccurred = [](JNIEnv* env) -> jthrowable { record(env, &JNINativeInterface_::ExceptionOccurred); return nullptr; };
+		functions.ExceptionClear = [](JNIEnv* env) { record(env, &JNINativeInterface_::ExceptionClear); };
+		functions.ExceptionDescribe = [](JNIEnv* env) { record(env, &JNINativeInterface_::ExceptionDescribe); };
+
+		functions.PushLocalFrame = [](JNIEnv* env, jint) -> jint { record(env, &JNINativeInterface_::PushLocalFrame); return JNI_OK; };
+		functions.PopLocalFrame = [](JNIEnv* env, jobject result) -> jobject { record(env, &JNINativeInterface_::PopLocalFrame); return result; };
+		functions.EnsureLocalCapacity = [](JNIEnv* env, jint) -> jint { record(env, &JNINativeInterface_::EnsureLocalCapacity); return JNI_OK; };
+		functions.NewLocalRef = [](JNIEnv* env, jobject object) -> jobject { record(env, &JNINativeInterface_::NewLocalRef); return object; };
+		functions.DeleteLocalRef = [](JNIEnv* env, jobject) { record(env, &JNINativeInterface_::DeleteLocalRef); };
+		functions.NewGlobalRef = [](JNIEnv* env, jobject object) -> jobject { record(env, &JNINativeInterface_::NewGlobalRef); return object; };
+		functions.DeleteGlobalRef = [](JNIEnv* env, jobject) { record(env, &JNINativeInterface_::DeleteGlobalRef); };
+		functions.NewWeakGlobalRef = [](JNIEnv* env, jobject object) -> jweak { record(env, &JNINativeInterface_::NewWeakGlobalRef); return object; };
+		functions.DeleteWeakGlobalRef = [](JNIEnv* env, jweak) { record(env, &JNINativeInterface_::DeleteWeakGlobalRef); };
+
+		functions.GetFieldID = [](JNIEnv* env, jclass, const char*, const char*) -> jfieldID { record(env, &JNINativeInterface_::GetFieldID); return (jfieldID)1; };
+		functions.GetStaticFieldID = [](JNIEnv* env, jclass, const char*, const char*) -> jfieldID { record(env, &JNINativeInterface_::GetStaticFieldID); return (jfieldID)2; };
+		functions.GetMethodID = [](JNIEnv* env, jclass, const char*, const char*) -> jmethodID { record(env, &JNINativeInterface_::GetMethodID); return (jmethodID)3; };
+		functions.GetStaticMethodID = [](JNIEnv* env, jclass, const char*, const char*) -> jmethodID { record(env, &JNINativeInterface_::GetStaticMethodID); return (jmethodID)4; };
+		functions.NewObjectA = [](JNIEnv* env, jclass, jmethodID, const jvalue*) -> jobject { record(env, &JNINativeInterface_::NewObjectA); return fake_object; };
+		functions.NewObjectV = [](JNIEnv* env, jclass, jmethodID, va_list) -> jobject { record(env, &JNINativeInterface_::NewObjectV); return fake_object; };
+
+		functions.NewStringUTF = [](JNIEnv* env, const char*) -> jstring { record(env, &JNINativeInterface_::NewStringUTF); return (jstring)fake_object; };
+		functions.GetStringLength = [](JNIEnv* env, jstring) -> jsize { record(env, &JNINativeInterface_::GetStringLength); return 4; };
+		functions.GetStringUTFLength = [](JNIEnv* env, jstring) -> jsize { record(env, &JNINativeInterface_::GetStringUTFLength); return 4; };
+		functions.GetStringUTFChars = [](JNIEnv* env, jstring, jboolean* is_copy) -> const char* { record(env, &JNINativeInterface_::GetStringUTFChars); if (is_copy) *is_copy = JNI_FALSE; return "mock"; };
+		functions.ReleaseStringUTFChars = [](JNIEnv* env, jstring, const char*) { record(env, &JNINativeInterface_::ReleaseStringUTFChars); };
+		functions.GetStringUTFRegion = [](JNIEnv* env, jstring, jsize start, jsize length, char* buffer) { record(env, &JNINativeInterface_::GetStringUTFRegion); std::memcpy(buffer, "mock" + start, length); buffer[length] = '\0'; };
+
+		functions.GetArrayLength = [](JNIEnv* env, jarray) -> jsize { return record(env, &JNINativeInterface_::GetArrayLength).array_length; };
+		functions.NewObjectArray = [](JNIEnv* env, jsize, jclass, jobject) -> jobjectArray { record(env, &JNINativeInterface_::NewObjectArray); return (jobjectArray)fake_object; };
+		functions.GetObjectArrayElement = [](JNIEnv* env, jobjectArray, jsize) -> jobject { return record(env, &JNINativeInterface_::GetObjectArrayElement).values.l; };
+		functions.SetObjectArrayElement = [](JNIEnv* env, jobjectArray, jsize, jobject) { record(env, &JNINativeInterface_::SetObjectArrayElement); };
+
+#define MOCK_JNI_TYPE(type, java_name, member) \
+		functions.Get##java_name##Field = [](JNIEnv* env, jobject, jfieldID) -> type { return record(env, &JNINativeInterface_::Get##java_name##Field).values.member; }; \
+		functions.Set##java_name##Field = [](JNIEnv* env, jobject, jfieldID, type value) { record(env, &JNINativeInterface_::Set##java_name##Field).values.member = value; }; \
+		functions.GetStatic##java_name##Field = [](JNIEnv* env, jclass, jfieldID) -> type { return record(env, &JNINativeInterface_::GetStatic##java_name##Field).values.member; }; \
+		functions.SetStatic##java_name##Field = [](JNIEnv* env, jclass, jfieldID, type value) { record(env, &JNINativeInterface_::SetStatic##java_name##Field).values.member = value; }; \
+		functions.Call##java_name##MethodV = [](JNIEnv* env, jobject, jmethodID, va_list) -> type { return record(env, &JNINativeInterface_::Call##java_name##MethodV).values.member; }; \
+		functions.Call##java_name##MethodA = [](JNIEnv* env, jobject, jmethodID, const jvalue*) -> type { return record(env, &JNINativeInterface_::Call##java_name##MethodA).values.member; }; \
+		functions.CallStatic##java_name##MethodV = [](JNIEnv* env, jclass, jmethodID, va_list) -> type { return record(env, &JNINativeInterface_::CallStatic##java_name##MethodV).values.member; }; \
+		functions.CallStatic##java_name##MethodA = [](JNIEnv* env, jclass, jmethodID, const jvalue*) -> type { return record(env, &JNINativeInterface_::CallStatic##java_name##MethodA).values.member; };
+#define MOCK_JNI_PRIMITIVE_TYPE(type, java_name, member) \
+		MOCK_JNI_TYPE(type, java_name, member) \
+		functions.New##java_name##Array = [](JNIEnv* env, jsize) -> type##Array { record(env, &JNINativeInterface_::New##java_name##Array); return (type##Array)fake_object; }; \
+		functions.Get##java_name##ArrayRegion = [](JNIEnv* env, type##Array, jsize, jsize length, type* buffer) { type value = record(env, &JNINativeInterface_::Get##java_name##ArrayRegion).values.member; for (jsize i = 0; i < length; ++i) buffer[i] = value; }; \
+		functions.Set##java_name##ArrayRegion = [](JNIEnv* env, type##Array, jsize, jsize, const type*) { record(env, &JNINativeInterface_::Set##java_name##ArrayRegion); };
+
+		MOCK_JNI_TYPE(jobject, Object, l)
+		MOCK_JNI_PRIMITIVE_TYPE(jboolean, Boolean, z)
+		MOCK_JNI_PRIMITIVE_TYPE(jbyte, Byte, b)
+		MOCK_JNI_PRIMITIVE_TYPE(jchar, Char, c)
+		MOCK_JNI_PRIMITIVE_TYPE(jshort, Short, s)
+		MOCK_JNI_PRIMITIVE_TYPE(jint, Int, i)
+		MOCK_JNI_PRIMITIVE_TYPE(jfloat, Float, f)
+		MOCK_JNI_PRIMITIVE_TYPE(jlong, Long, j)
+		MOCK_JNI_PRIMITIVE_TYPE(jdouble, Double, d)
+#undef MOCK_JNI_PRIMITIVE_TYPE
+#undef MOCK_JNI_TYPE
+
+		functions.CallVoidMethodV = [](JNIEnv* env, jobject, jmethodID, va_list) { record(env, &JNINativeInterface_::CallVoidMethodV); };
+		functions.CallVoidMethodA = [](JNIEnv* env, jobject, jmethodID, const jvalue*) { record(env, &JNINativeInterface_::CallVoidMethodA); };
+		functions.CallStaticVoidMethodV = [](JNIEnv* env, jclass, jmethodID, va_list) { record(env, &JNINativeInterface_::CallStaticVoidMethodV); };
+		functions.CallStaticVoidMethodA = [](JNIEnv* env, jclass, jmethodID, const jvalue*) { record(env, &JNINativeInterface_::CallStaticVoidMethodA); };
+	}
+
+	mock_jni_env(const mock_jni_env&) = delete; // the JNIEnv points to its own function table
+
+	JNIEnv* get()
+	{
+		return &env;
+	}
+
+	template<class function_type>
+	size_t slot(function_type JNINativeInterface_::* function) const
+	{
+		return (size_t)((const char*)&(functions.*function) - (const char*)&functions) / sizeof(void*);
+	}
+
+	template<class function_type>
+	uint64_t count(function_type JNINativeInterface_::* function) const
+	{
+		return calls[slot(function)];
+	}
+
+	uint64_t total_calls() const
+	{
+		uint64_t total = 0;
+		for (uint64_t count : calls)
+			total += count;
+		return total;
+	}
+
+	void reset_calls()
+	{
+		calls.fill(0);
+	}
+private:
+	template<class function_type>
+	static mock_jni_env& record(JNIEnv* env, function_type JNINativeInterface_::* function)
+	{
+		mock_jni_env& self = *(mock_jni_env*)env;
+		++self.calls[self.slot(function)];
+		return self;
+	}
+
+	static void JNICALL unexpected_call()
+	{
+		std::fputs("mock_jni_env: a JNI function that isn't mocked was called\n", stderr);
+		std::abort();
+	}
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+// the example mappings without their helper functions, included after meta_jni.hpp or after import metajni; + meta_jni_macros.hpp
+namespace bench
+{
+	BEGIN_KLASS_DEF(Object, "java/lang/Object")
+	END_KLASS_DEF()
+
+	BEGIN_KLASS_DEF(String, "java/lang/String")
+	END_KLASS_DEF()
+
+	BEGIN_KLASS_DEF(Collection, "java/util/Collection")
+		jni::method<jni::array<Object>, "toArray"> toArray{ *this };
+	END_KLASS_DEF()
+	BEGIN_KLASS_DEF_EX(List, "java/util/List", Collection)
+	END_KLASS_DEF()
+
+	BEGIN_KLASS_DEF(Entity, "pk")
+		jni::method<String, "e_"> getName{ *this };
+		jni::field<jdouble, "s"> posX{ *this };
+		jni::field<jdouble, "t"> posY{ *this };
+		jni::field<jdouble, "u"> posZ{ *this };
+	END_KLASS_DEF()
+	BEGIN_KLASS_DEF_EX(EntityLivingBase, "pr", Entity)
+		jni::method<jfloat, "bn"> getHealth{ *this };
+	END_KLASS_DEF()
+	BEGIN_KLASS_DEF_EX(EntityPlayer, "wn", EntityLivingBase)
+	END_KLASS_DEF()
+	BEGIN_KLASS_DEF_EX(EntityPlayerSP, "bew", EntityPlayer)
+		jni::method<void, "e", jni::NOT_STATIC, String> sendChatMessage{ *this };
+		jni::method<String, "w", jni::NOT_STATIC> getClientBrand{ *this };
+	END_KLASS_DEF()
+
+	BEGIN_KLASS_DEF(World, "adm")
+		jni::field<List, "j"> playerEntities{ *this };
+	END_KLASS_DEF()
+	BEGIN_KLASS_DEF_EX(WorldClient, "bdb", World)
+	END_KLASS_DEF()
+
+	BEGIN_KLASS_DEF(Minecraft, "ave")
+		jni::field<Minecraft, "S", jni::STATIC> theMinecraft{ *this };
+		jni::field<jint, "d"> displayWidth{ *this };
+		jni::field<EntityPlayerSP, "h"> thePlayer{ *this };
+		jni::field<WorldClient, "f"> theWorld{ *this };
+
+		jni::method<void, "aw", jni::NOT_STATIC> clickMouse{ *this };
+		jni::method<void, "a", jni::NOT_STATIC, jint, jint> resize{ *this };
+	END_KLASS_DEF()
+}
@@ -0,0 +1,142 @@
+// Converts a binary trace written by jni::trace::start into Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev)
+// usage: metajni_trace_to_json trace.bin trace.json
+#define METAJNI_CALL_TRACE
+#include "meta_jni.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+struct site_info
+{
+	std::string klass_name;
+	std::string name;
+	std::string signature;
+	bool is_static = false;
+};
+
+struct thread_events
+{
+	uint64_t thread_id;
+	std::vector<jni::trace::event> events;
+};
+
+template<class T> static bool read(std::ifstream& in, T& value)
+{
+	return (bool)in.read((char*)&value, sizeof(T));
+}
+
+static bool read_string(std::ifstream& in, std::string& str)
+{
+	uint16_t size = 0;
+	if (!read(in, size)) return false;
+	str.resize(size);
+	return (bool)in.read(str.data(), size);
+}
+
+static void write_json_string(std::ostream& out, const std::string& str)
+{
+	out << '"';
+	for (char c : str)
+	{
+		if (c == '"' || c == '\\') out << '\\';
+		out << c;
+	}
+	out << '"';
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 3)
+	{
+		std::cerr << "usage: " << argv[0] << " trace.bin trace.json\n";
+		return 1;
+	}
+	std::ifstream in{ argv[1], std::ios::binary };
+	char magic[sizeof(jni::trace::file_magic)] = {};
+	if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), jni::trace::file_magic))
+	{
+		std::cerr << argv[1] << " is not a MetaJNI trace\n";
+		return 1;
+	}
+
+	std::map<uint32_t, site_info> sites{};
+	std::vector<thread_events> batches{};
+	std::vector<std::pair<uint64_t, uint64_t>> clocks{}; // ticks, ns
+	std::map<uint64_t, uint64_t> dropped{};
+	uint8_t type = 0;
+	while (read(in, type))
+	{
+		if (type == jni::trace::SITE_RECORD)
+		{
+			uint32_t index = 0;
+			uint8_t is_static = 0;
+			site_info info{};
+			if (!read(in, index) || !read(in, is_static) || !read_string(in, info.klass_name) || !read_string(in, info.name) || !read_string(in, info.signature)) break;
+			info.is_static = is_static;
+			sites[index] = info;
+		}
+		else if (type == jni::trace::CLOCK_RECORD)
+		{
+			uint64_t ticks = 0, ns = 0;
+			if (!read(in, ticks) || !read(in, ns)) break;
+			clocks.emplace_back(ticks, ns);
+		}
+		else if (type == jni::trace::EVENTS_RECORD)
+		{
+			thread_events batch{};
+			uint64_t dropped_events = 0;
+			uint32_t count = 0;
+			if (!read(in, batch.thread_id) || !read(in, dropped_events) || !read(in, count)) break;
+			batch.events.resize(count);
+			if (!in.read((char*)batch.events.data(), count * sizeof(jni::trace::event))) break;
+			dropped[batch.thread_id] = dropped_events;
+			batches.push_back(std::move(batch));
+		}
+		else
+		{
+			std::cerr << "corrupted record, stopping\n";
+			break;
+		}
+	}
+	if (clocks.empty())
+	{
+		std::cerr << "no clock record\n";
+		return 1;
+	}
+
+	// ticks are TSC on x86 and ns elsewhere, the first and last clock records give the rate
+	double ticks_per_ns = 1.0;
+	if (clocks.size() > 1 && clocks.back().second > clocks.front().second)
+		ticks_per_ns = (double)(clocks.back().first - clocks.front().first) / (double)(clocks.back().second - clocks.front().second);
+	uint64_t origin = clocks.front().first;
+	auto to_us = [&](uint64_t ticks) { return (double)(int64_t)(ticks - origin) / ticks_per_ns / 1000.0; };
+
+	std::ofstream out{ argv[2] };
+	out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	bool first = true;
+	size_t total = 0;
+	for (const thread_events& batch : batches)
+	{
+		for (const jni::trace::event& e : batch.events)
+		{
+			const site_info& site = sites[e.site_index];
+			out << (first ? "\n" : ",\n") << "{\"ph\":\"X\",\"cat\":\"jni\",\"pid\":1,\"tid\":" << batch.thread_id
+				<< ",\"ts\":" << to_us(e.start_ticks) << ",\"dur\":" << (double)(e.end_ticks - e.start_ticks) / ticks_per_ns / 1000.0 << ",\"name\":";
+			write_json_string(out, site.klass_name.empty() ? site.name : site.klass_name + '.' + site.name);
+			out << ",\"args\":{\"signature\":";
+			write_json_string(out, site.signature);
+			out << ",\"static\":" << (site.is_static ? "true" : "false") << ",\"exception\":" << (e.exception ? "true" : "false") << "}}";
+			first = false;
+			++total;
+		}
+	}
+	out << "\n]}\n";
+
+	std::cout << total << " events, " << sites.size() << " members, " << dropped.size() << " threads\n";
+	for (const auto& [thread_id, count] : dropped)
+		if (count) std::cout << "thread " << thread_id << " dropped " << count << " events (ring full)\n";
+	return 0;
+}
@@ -0,0 +1,136 @@
+// Overhead of the wrappers over raw JNI, on a mock JNIEnv whose functions only count their calls (no JVM needed)
+// each operation runs through MetaJNI and written by hand with raw JNI, the JNI calls per operation are exact, the timings are the wrapper's own cost
+#include "meta_jni.hpp"
+#include "mock_jni_env.hpp"
+#include "bench_harness.hpp"
+
+namespace bench
+{
+	BEGIN_KLASS_DEF(String, "java/lang/String")
+	END_KLASS_DEF()
+
+	BEGIN_KLASS_DEF(Entity, "pk")
+		jni::field<jdouble, "s"> posX{ *this };
+		jni::method<String, "e_"> getName{ *this };
+	END_KLASS_DEF()
+	BEGIN_KLASS_DEF_EX(EntityPlayerSP, "bew", Entity)
+	END_KLASS_DEF()
+
+	BEGIN_KLASS_DEF(Minecraft, "ave")
+		jni::field<Minecraft, "S", jni::STATIC> theMinecraft{ *this };
+		jni::field<EntityPlayerSP, "h"> thePlayer{ *this };
+		jni::field<jint, "d"> displayWidth{ *this };
+		jni::method<void, "a", jni::NOT_STATIC, jint, jint> resize{ *this };
+	END_KLASS_DEF()
+}
+
+struct raw_ids // what hand written JNI code caches once
+{
+	jclass minecraft_class;
+	jfieldID the_minecraft;
+	jfieldID display_width;
+	jmethodID resize;
+	jfieldID pos_x;
+	jmethodID get_name;
+};
+
+int main(int argc, char** argv)
+{
+	bench_options options{};
+	if (!parse_bench_options(argc, argv, options)) return 1;
+
+	mock_jni_env mock{};
+	JNIEnv* env = mock.get();
+	// jni::init reads a TLS index of 0 as "not initialized", but 0 is the first one of a process that never allocated any (a JVM always has)
+#ifdef _WIN32
+	TlsAlloc();
+#elif __linux__
+	pthread_key_t reserved_key;
+	pthread_key_create(&reserved_key, nullptr);
+#endif
+	jni::init();
+	jni::set_thread_env(env);
+
+	jobject minecraft_object = mock_jni_env::fake_object;
+	jobject player_object = mock_jni_env::fake_object;
+	jintArray int_array = (jintArray)mock_jni_env::fake_object;
+	raw_ids raw{};
+	raw.minecraft_class = (jclass)env->NewGlobalRef(env->FindClass("ave"));
+	raw.the_minecraft = env->GetStaticFieldID(raw.minecraft_class, "S", "Lave;");
+	raw.display_width = env->GetFieldID(raw.minecraft_class, "d", "I");
+	raw.resize = env->GetMethodID(raw.minecraft_class, "a", "(II)V");
+	jclass entity_class = env->FindClass("pk");
+	raw.pos_x = env->GetFieldID(entity_class, "s", "D");
+	raw.get_name = env->GetMethodID(entity_class, "e_", "()Ljava/lang/String;");
+
+	bench::Minecraft minecraft{ minecraft_object };
+	bench::EntityPlayerSP player{ player_object };
+	jni::array<jint> ints{ int_array };
+
+#ifdef METAJNI_CALL_TRACE
+	bench_report report{ "MetaJNI_bench_trace" };
+#else
+	bench_report report{ "MetaJNI_bench" };
+#endif
+	auto run = [&](const char* name, auto&& wrapper_operation, auto&& raw_operation)
+	{
+		wrapper_operation(); // classes and member ids resolved before counting
+		mock.reset_calls();
+		bench_stats wrapper = measure(options, wrapper_operation);
+		wrapper.jni_calls_per_op = (double)mock.total_calls() / (double)options.operations();
+		raw_operation();
+		mock.reset_calls();
+		bench_stats raw_stats = measure(options, raw_operation);
+		raw_stats.jni_calls_per_op = (double)mock.total_calls() / (double)options.operations();
+		report.add(name, wrapper, raw_stats);
+	};
+
+	run("field_get",
+		[&] { keep(player.posX.get()); },
+		[&] { keep(env->GetDoubleField(player_object, raw.pos_x)); });
+	run("field_set",
+		[&] { minecraft.displayWidth = 854; },
+		[&] { env->SetIntField(minecraft_object, raw.display_width, 854); });
+	run("static_field_get_object",
+		[&] { keep(minecraft.theMinecraft.get().object_instance); },
+		[&] { keep(env->GetStaticObjectField(raw.minecraft_class, raw.the_minecraft)); });
+	run("method_call_void",
+		[&] { minecraft.resize(854, 480); },
+		[&] { env->CallVoidMethod(minecraft_object, raw.resize, 854, 480); });
+#ifdef METAJNI_CALL_TRACE
+	{
+		// recording without jni::trace::start, the ring is drained here instead of by the writer thread so no event is dropped,
+		// the difference with method_call_void (one relaxed load while tracing is stopped) is the cost of an event
+		jni::trace::ring& ring = jni::trace::_rings.get();
+		jni::trace::_active = true;
+		run("method_call_void_traced",
+			[&] { minecraft.resize(854, 480); ring.tail.store(ring.head.load(std::memory_order_relaxed), std::memory_order_release); },
+			[&] { env->CallVoidMethod(minecraft_object, raw.resize, 854, 480); });
+		jni::trace::_active = false;
+	}
+#endif
+	run("method_call_object",
+		[&] { keep(player.getName().object_instance); },
+		[&] { keep(env->CallObjectMethod(player_object, raw.get_name)); });
+	run("klass_construct",
+		[&] { bench::Minecraft constructed{ minecraft_object }; keep(constructed.object_instance); },
+		[&] { keep(minecraft_object); });
+	run("klass_copy",
+		[&] { bench::Minecraft copy{ minecraft }; keep(copy.object_instance); },
+		[&] { keep(minecraft_object); });
+	run("array_to_vector",
+		[&] { keep(ints.to_vector().size()); },
+		[&]
+		{
+			std::vector<jint> values(env->GetArrayLength(int_array));
+			env->GetIntArrayRegion(int_array, 0, (jsize)values.size(), values.data());
+			keep(values.size());
+		});
+	run("get_cached_jclass", // raw: a FindClass per lookup, what code without a class cache does
+		[&] { keep(jni::get_cached_jclass<bench::Minecraft>()); },
+		[&] { jclass found = env->FindClass("ave"); keep(found); env->DeleteLocalRef(found); });
+
+	env->DeleteGlobalRef(raw.minecraft_class);
+	jni::shutdown();
+	return report.finish(options);
+}